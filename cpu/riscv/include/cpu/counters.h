@@ -0,0 +1,54 @@
+
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef RISCV_ESP_PERFCNT
+// ESP RISC-V cores lack `mcycle` and `minstret` and instead have one 32-bit performance counter.
+// Performance counter event select.
+#define CSR_ESP_MPCER      0x7e0
+// Performance counter mode.
+#define CSR_ESP_MPCMR      0x7e1
+// Performance counter value.
+#define CSR_ESP_MPCCR      0x7e2
+// MPCER event: CPU cycles.
+#define ESP_MPCER_CYCLES   0x01
+// MPCMR: enable counting.
+#define ESP_MPCMR_COUNT_EN 0x01
+#endif
+
+
+
+// Start the cycle and instruction counters.
+static inline void cpu_counters_init() {
+#ifdef RISCV_ESP_PERFCNT
+    asm volatile("csrw %0, %1" ::"i"(CSR_ESP_MPCER), "r"(ESP_MPCER_CYCLES));
+    asm volatile("csrw %0, %1" ::"i"(CSR_ESP_MPCMR), "r"(ESP_MPCMR_COUNT_EN));
+#else
+    // The standard `mcycle` and `minstret` count from reset.
+#endif
+}
+
+// Read the lower 32 bits of the cycle counter.
+static inline uint32_t cpu_cycles() {
+    uint32_t value;
+#ifdef RISCV_ESP_PERFCNT
+    asm volatile("csrr %0, %1" : "=r"(value) : "i"(CSR_ESP_MPCCR));
+#else
+    asm volatile("csrr %0, mcycle" : "=r"(value));
+#endif
+    return value;
+}
+
+// Read the lower 32 bits of the retired instruction counter, or 0 if the CPU doesn't have one.
+static inline uint32_t cpu_instret() {
+#ifdef RISCV_ESP_PERFCNT
+    return 0;
+#else
+    uint32_t value;
+    asm volatile("csrr %0, minstret" : "=r"(value));
+    return value;
+#endif
+}
@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "attributes.h"
+#include "badge_strings.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Copy performed by the handover trampoline.
+typedef struct {
+    // Destination address.
+    uint32_t dest;
+    // Source address.
+    uint32_t src;
+    // Length in bytes.
+    uint32_t len;
+} trampoline_copy_t;
+
+// Handover trampoline; performs `count` copies in order, then jumps to `entry`.
+// It does not use the stack, so the copies may overwrite everything except the trampoline and `copies` themselves.
+typedef void (*trampoline_t)(trampoline_copy_t const *copies, size_t count, size_t entry) NORETURN;
+
+// NOLINTBEGIN
+// Position-independent code of the trampoline, to be copied elsewhere before it is called.
+extern char const trampoline_start[];
+// End of the trampoline code.
+extern char const trampoline_end[];
+// NOLINTEND
+
+// Copy the trampoline and its `count` copies to `mem`, then run it.
+// `mem` must be executable and lie outside every copy destination.
+static inline NORETURN void trampoline_run(void *mem, trampoline_copy_t const *copies, size_t count, size_t entry) {
+    size_t code_len = trampoline_end - trampoline_start;
+    mem_copy(mem, trampoline_start, code_len);
+    trampoline_copy_t *table = (trampoline_copy_t *)((char *)mem + ((code_len + 3) & ~3));
+    mem_copy(table, copies, count * sizeof(trampoline_copy_t));
+    asm volatile("fence.i" ::: "memory");
+    ((trampoline_t)mem)(table, count, entry);
+}
@@ -17,6 +17,7 @@ void panic_abort() {
 // Immediately power off or reset the system.
 void panic_poweroff() {
     rawprint("**** KERNEL PANIC ****\nhalted\n");
+    rawflush();
     asm volatile("csrci mstatus, 0xa");
     while (1) asm volatile("wfi");
 }
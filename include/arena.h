@@ -0,0 +1,35 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// The boot arena is a bump allocator over the free SRAM after the bootloader's `.bss`.
+// The whole arena lies above `__start_data`, which kernel segments are only copied to by the handover trampoline,
+// so its memory stays valid until `arena_release` is called right before the trampoline runs.
+
+// Position in the arena to return to; everything allocated after it is freed by `arena_restore`.
+typedef size_t arena_mark_t;
+
+// Allocate `size` bytes aligned to `align` (a power of two), or NULL if the arena is full or released.
+void        *arena_alloc(size_t size, size_t align);
+// Allocate `size` zeroed bytes aligned to `align` (a power of two), or NULL if the arena is full or released.
+void        *arena_calloc(size_t size, size_t align);
+// Get the current position in the arena.
+arena_mark_t arena_mark();
+// Free everything allocated after `mark`.
+void         arena_restore(arena_mark_t const *mark);
+// Number of bytes currently allocated.
+size_t       arena_used();
+// Most bytes allocated at once.
+size_t       arena_high_water();
+// Total size of the arena.
+size_t       arena_size();
+// Print the arena usage.
+void         arena_stats();
+// Free the entire arena for good before the kernel overwrites it; later allocations fail.
+void         arena_release();
+
+// Free everything allocated in the rest of the enclosing scope when it ends.
+#define ARENA_SCOPE(id) arena_mark_t arena_scope_##id __attribute__((cleanup(arena_restore))) = arena_mark()
@@ -19,11 +19,19 @@ typedef struct {
 
 
 
+// Number of entries up to which `array_sort_buf` uses insertion sort.
+#define ARRAY_SORT_RUN 16
+
 // Comparator function for sorting functions.
 typedef int (*array_sort_comp_t)(void const *a, void const *b);
-// Sort a contiguous array given a comparator function.
-// The array is sorted into ascending order.
+// Sort a contiguous array in place given a comparator function; meant for small arrays.
+// The array is sorted into ascending order; entries that compare equal keep their order.
 void              array_sort(void *array, size_t ent_size, size_t ent_count, array_sort_comp_t comparator);
+// Sort a contiguous array given a comparator function, using `tmp` of at least `ent_count / 2` entries.
+// The array is sorted into ascending order; entries that compare equal keep their order.
+void              array_sort_buf(
+    void *array, void *tmp, size_t ent_size, size_t ent_count, array_sort_comp_t comparator
+);
 // Binary search for a value in a sorted (ascending order) array.
 array_binsearch_t array_binsearch(
     void const *array, size_t ent_size, size_t ent_count, void const *value, array_sort_comp_t comparator
@@ -84,3 +92,50 @@ static inline void array_sorted_insert(
     size_t index = array_binsearch(array, ent_size, ent_count, insert, comparator).index;
     array_insert(array, ent_size, ent_count, insert, index);
 }
+
+
+
+// Define sorts for arrays of `type` that inline the comparison `less(type const *a, type const *b)`.
+// `name(array, count)` is an in-place binary insertion sort for small arrays and `name##_buf(array, tmp, count)` a
+// merge sort using `tmp` of at least `count / 2` entries; both sort into ascending order and keep equal entries' order.
+#define ARRAY_SORT_DEFINE(name, type, less)                                                                            \
+    static inline void name(type *array, size_t count) {                                                               \
+        for (size_t i = 1; i < count; i++) {                                                                           \
+            if (!less(&array[i], &array[i - 1])) {                                                                     \
+                continue;                                                                                              \
+            }                                                                                                          \
+            type   tmp = array[i];                                                                                     \
+            size_t lo  = 0;                                                                                            \
+            size_t hi  = i - 1;                                                                                        \
+            while (lo < hi) {                                                                                          \
+                size_t mid = lo + (hi - lo) / 2;                                                                       \
+                if (less(&tmp, &array[mid])) {                                                                         \
+                    hi = mid;                                                                                          \
+                } else {                                                                                               \
+                    lo = mid + 1;                                                                                      \
+                }                                                                                                      \
+            }                                                                                                          \
+            __builtin_memmove(&array[lo + 1], &array[lo], sizeof(type) * (i - lo));                                    \
+            array[lo] = tmp;                                                                                           \
+        }                                                                                                              \
+    }                                                                                                                  \
+    static inline void name##_buf(type *array, type *tmp, size_t count) {                                              \
+        if (count <= ARRAY_SORT_RUN) {                                                                                 \
+            name(array, count);                                                                                        \
+            return;                                                                                                    \
+        }                                                                                                              \
+        size_t avl_a = count / 2;                                                                                      \
+        size_t avl_b = count - avl_a;                                                                                  \
+        type  *arr_b = array + avl_a;                                                                                  \
+        name##_buf(array, tmp, avl_a);                                                                                 \
+        name##_buf(arr_b, tmp, avl_b);                                                                                 \
+        if (!less(arr_b, arr_b - 1)) {                                                                                 \
+            return;                                                                                                    \
+        }                                                                                                              \
+        __builtin_memcpy(tmp, array, sizeof(type) * avl_a);                                                            \
+        size_t i = 0, a = 0, b = 0;                                                                                    \
+        while (a < avl_a && b < avl_b) {                                                                               \
+            array[i++] = less(&arr_b[b], &tmp[a]) ? arr_b[b++] : tmp[a++];                                             \
+        }                                                                                                              \
+        __builtin_memcpy(array + i, tmp + a, sizeof(type) * (avl_a - a));                                              \
+    }
@@ -40,3 +40,46 @@ crc32_t _crc32_update(crc32_t crc, void const *mem, size_t len) PURE;
     do {                                                                                                               \
         *(crc) ^= 0xffffffff;                                                                                          \
     } while (0)
+
+
+
+// SHA-256 digest size in bytes.
+#define SHA256_DIGEST_LEN 32
+// SHA-512 digest size in bytes.
+#define SHA512_DIGEST_LEN 64
+
+// SHA-256 state.
+typedef struct {
+    // Intermediate hash value.
+    uint32_t state[8];
+    // Number of bytes hashed so far.
+    uint64_t length;
+    // Partial message block.
+    uint8_t  block[64];
+} sha256_t;
+
+// SHA-512 state.
+typedef struct {
+    // Intermediate hash value.
+    uint64_t state[8];
+    // Number of bytes hashed so far.
+    uint64_t length;
+    // Partial message block.
+    uint8_t  block[128];
+} sha512_t;
+
+// Initialize a SHA-256 hash.
+void sha256_init(sha256_t *ctx);
+// Add data to a SHA-256 hash.
+void sha256_update(sha256_t *ctx, void const *mem, size_t len);
+// Finalize a SHA-256 hash and write the digest.
+void sha256_final(sha256_t *ctx, uint8_t digest[SHA256_DIGEST_LEN]);
+// Hash whole 64-byte blocks into a SHA-256 intermediate hash value.
+void sha256_blocks(uint32_t state[8], void const *mem, size_t count);
+
+// Initialize a SHA-512 hash.
+void sha512_init(sha512_t *ctx);
+// Add data to a SHA-512 hash.
+void sha512_update(sha512_t *ctx, void const *mem, size_t len);
+// Finalize a SHA-512 hash and write the digest.
+void sha512_final(sha512_t *ctx, uint8_t digest[SHA512_DIGEST_LEN]);
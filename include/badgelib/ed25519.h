@@ -0,0 +1,18 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Ed25519 public key size in bytes.
+#define ED25519_PUBKEY_LEN    32
+// Ed25519 signature size in bytes.
+#define ED25519_SIGNATURE_LEN 64
+
+// Verify an Ed25519 signature (RFC 8032) over a message.
+// Rejects non-canonical public keys and signature scalars.
+bool ed25519_verify(
+    uint8_t const sig[ED25519_SIGNATURE_LEN], uint8_t const pubkey[ED25519_PUBKEY_LEN], void const *msg, size_t msg_len
+);
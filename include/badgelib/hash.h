@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "checksum.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+
+// SHA-256 hash computed by a hash engine.
+typedef struct hash hash_t;
+// SHA-256 hash engine.
+typedef struct hash_engine hash_engine_t;
+
+// SHA-256 hash engine.
+// The generic code buffers and pads the message; engines only process whole 64-byte blocks.
+struct hash_engine {
+    // Next hash engine.
+    hash_engine_t *next;
+    // Engine name.
+    char const    *name;
+    // Try to claim the engine and start a new hash.
+    bool (*claim)(hash_t *ctx);
+    // Hash whole 64-byte blocks.
+    // The engine may still be working on the last block when this returns.
+    void (*blocks)(hash_t *ctx, void const *mem, size_t count);
+    // Wait for the engine, write the intermediate hash value as bytes and release the engine.
+    void (*finish)(hash_t *ctx, uint8_t digest[SHA256_DIGEST_LEN]);
+};
+
+// SHA-256 hash computed by a hash engine.
+struct hash {
+    // Engine computing this hash.
+    hash_engine_t const *engine;
+    // Message length and partial block; the state is only used by the software engine.
+    sha256_t             sw;
+};
+
+
+
+// Software hash engine; always available.
+extern hash_engine_t const hash_engine_sw;
+
+// Register a new hash engine, preferred over the software engine.
+// This should only be called from constructor functions.
+void hash_engine_register(hash_engine_t *engine);
+
+// Start a new hash on the first registered engine that is available, or in software.
+void hash_init(hash_t *ctx);
+// Start a new hash on a specific engine.
+bool hash_init_engine(hash_t *ctx, hash_engine_t const *engine);
+// Add data to a hash.
+void hash_update(hash_t *ctx, void const *mem, size_t len);
+// Finalize a hash and write the digest.
+void hash_final(hash_t *ctx, uint8_t digest[SHA256_DIGEST_LEN]);
+// Abandon a hash and release its engine.
+void hash_abort(hash_t *ctx);
@@ -12,6 +12,17 @@ void rawprint_substr(char const *msg, size_t length);
 void rawprint(char const *msg);
 // Simple printer.
 void rawputc(char msg);
+// Simple non-blocking reader.
+// Returns -1 if no character is available.
+int  rawgetc();
+// Flush characters buffered by the output device.
+void rawflush();
+// Start draining output from a ring buffer by interrupts.
+void rawprint_async_start();
+// Flush buffered output and return to synchronous output.
+void rawprint_async_stop();
+// Callback to the output driver for when an output device interrupt fires.
+void rawprint_isr();
 // Bin 2 hex printer.
 void rawprinthex(uint64_t val, int digits);
 // Bin 2 dec printer.
@@ -24,6 +24,8 @@ typedef int64_t ALIGNED_TO(sizeof(size_t)) timer_value_t;
 void           time_init();
 // Get current time in microseconds.
 timestamp_us_t time_us();
+// Get the CPU cycle counter; wraps around, so only suitable for measuring short intervals.
+uint32_t       time_cycles();
 // Sets the alarm time when the next task switch should occur.
 void           time_set_next_task_switch(timestamp_us_t timestamp);
 
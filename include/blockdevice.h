@@ -103,6 +103,9 @@ void blkdev_write(badge_err_t *ec, blkdev_t *dev, blksize_t block, uint8_t const
 // Read a block.
 // This operation may be cached.
 void blkdev_read(badge_err_t *ec, blkdev_t *dev, blksize_t block, uint8_t *readbuf);
+// Read multiple consecutive blocks in a single device transfer.
+// Blocks present in the cache are served from it, the rest bypass the read cache.
+void blkdev_read_n(badge_err_t *ec, blkdev_t *dev, blksize_t block, blksize_t count, uint8_t *readbuf);
 // Partially write a block.
 // This is very likely to cause a read-modify-write operation.
 void blkdev_write_partial(
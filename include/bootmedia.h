@@ -34,27 +34,47 @@ typedef diskoff_t (*bootmedia_read_t)(bootmedia_t *media, diskoff_t offset, disk
 typedef bool (*bootmedia_mmap_t)(bootmedia_t *media, diskoff_t offset, diskoff_t length, size_t vaddr);
 // Memory map page size function.
 typedef diskoff_t (*bootmedia_page_t)(bootmedia_t *media, diskoff_t *page_size);
+// Bootable media direct address function.
+typedef void const *(*bootmedia_addr_t)(bootmedia_t *media, diskoff_t offset, diskoff_t length);
+
+// Single request of a vectored read.
+typedef struct {
+    // Media offset.
+    diskoff_t offset;
+    // Number of bytes to read.
+    diskoff_t length;
+    // Destination memory.
+    void     *mem;
+} bootmedia_iov_t;
+
+// Bootable media vectored read function; requests are sorted by offset in place.
+// Returns the total number of bytes read.
+typedef diskoff_t (*bootmedia_readv_t)(bootmedia_t *media, bootmedia_iov_t *iov, size_t count);
 
 // Abstract bootable device.
 struct bootmedia {
     // Previous boot media.
-    bootmedia_t     *prev;
+    bootmedia_t      *prev;
     // Next boot media.
-    bootmedia_t     *next;
+    bootmedia_t      *next;
     // Read function.
-    bootmedia_read_t read;
+    bootmedia_read_t  read;
     // Optional memory map function.
-    bootmedia_mmap_t mmap;
+    bootmedia_mmap_t  mmap;
     // Memory map page size function.
-    bootmedia_page_t page;
+    bootmedia_page_t  page;
+    // Optional function returning the address of media data that is plain memory.
+    bootmedia_addr_t  addr;
+    // Optional vectored read function.
+    bootmedia_readv_t readv;
     // Size in bytes.
-    diskoff_t        size;
+    diskoff_t         size;
     // Detected partitioning system, if any.
-    partsys_t       *partsys;
+    partsys_t        *partsys;
     // Number of partitions.
-    diskoff_t        part_num;
+    diskoff_t         part_num;
     // Selected partition, or -1 if none selected.
-    diskoff_t        part_sel;
+    diskoff_t         part_sel;
 };
 
 
@@ -68,4 +88,9 @@ extern size_t       bootmedia_num;
 
 // Register a new boot device.
 // This should only be called from constructor functions.
-void bootmedia_register(bootmedia_t *media);
+void      bootmedia_register(bootmedia_t *media);
+// Sort vectored read requests by offset.
+void      bootmedia_iov_sort(bootmedia_iov_t *iov, size_t count);
+// Read a batch of requests, sorting them by offset in place.
+// Returns the total number of bytes read.
+diskoff_t bootmedia_readv(bootmedia_t *media, bootmedia_iov_t *iov, size_t count);
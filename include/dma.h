@@ -0,0 +1,20 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+
+// Called on each chunk of a chunked copy once it has arrived at its destination.
+typedef void (*dma_chunk_func_t)(void *cookie, void const *mem, size_t len);
+
+// Start copying `len` bytes from `src` to `dest`, after waiting for the previous copy.
+// Buffers the DMA cannot reach are copied synchronously before this returns.
+void dma_copy_start(void *dest, void const *src, size_t len);
+// Wait for the last copy started to finish.
+void dma_copy_wait();
+// Copy `len` bytes in chunks of `chunk` bytes, calling `func` on each chunk while the next one is copied.
+void dma_copy_chunked(void *dest, void const *src, size_t len, size_t chunk, dma_chunk_func_t func, void *cookie);
@@ -23,6 +23,32 @@ typedef bool (*filesys_ident_t)(partition_t *part);
 typedef bool (*filesys_read_t)(partition_t *part, filesys_t *filesys, file_t *file);
 typedef diskoff_t (*file_read_t)(file_t *file, diskoff_t offset, diskoff_t length, void *mem);
 typedef bool (*file_mmap_t)(file_t *file, diskoff_t offset, diskoff_t length, size_t vaddr);
+typedef void const *(*file_addr_t)(file_t *file, diskoff_t offset, diskoff_t length);
+
+#ifdef HAS_FILE_READAHEAD
+#ifndef FILE_READAHEAD_SIZE
+// Size of the per-file read-ahead buffer; reads at least this large bypass it.
+#define FILE_READAHEAD_SIZE 256
+#endif
+
+// Read-ahead buffer of a file.
+typedef struct {
+    // Underlying file reading function.
+    file_read_t read;
+    // File offset of the buffered data.
+    diskoff_t   offset;
+    // Number of bytes buffered.
+    diskoff_t   length;
+    // Reads served from the buffer.
+    uint32_t    hits;
+    // Reads that refilled the buffer.
+    uint32_t    misses;
+    // Reads that bypassed the buffer.
+    uint32_t    bypasses;
+    // Buffered data.
+    uint8_t     data[FILE_READAHEAD_SIZE];
+} file_readahead_t;
+#endif
 
 // Abstract filesystem type.
 struct filesys_type {
@@ -34,6 +60,8 @@ struct filesys_type {
     filesys_ident_t ident;
     // Try to open the kernel file on this filesystem.
     filesys_read_t  read;
+    // Partition filesystem hint this type matches.
+    part_fs_t       hint;
 };
 
 // Mounted filesystem information.
@@ -58,6 +86,8 @@ struct file {
     file_read_t read;
     // File memory mapping function.
     file_mmap_t mmap;
+    // Optional function returning the address of file data that is plain memory.
+    file_addr_t addr;
     // File inode, if any.
     int         inode;
     // File first sector number, if any.
@@ -66,6 +96,10 @@ struct file {
     diskoff_t   cur_off;
     // File current sector number, if any.
     diskoff_t   cur_sec;
+#ifdef HAS_FILE_READAHEAD
+    // Read-ahead buffer.
+    file_readahead_t readahead;
+#endif
 };
 
 
@@ -85,3 +119,10 @@ extern filesys_type_t filesys_type_raw;
 // Register a new filesystem type.
 // This should only be called from constructor functions.
 void filesys_type_register(filesys_type_t *type);
+
+#ifdef HAS_FILE_READAHEAD
+// Put the read-ahead buffer in front of an opened file's reading function.
+void file_readahead_init(file_t *file);
+// Log the read-ahead statistics of a file.
+void file_readahead_stats(file_t const *file);
+#endif
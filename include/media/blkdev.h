@@ -0,0 +1,18 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "blockdevice.h"
+#include "bootmedia.h"
+
+// Boot media backed by a block device.
+typedef struct {
+    // Abstract boot media.
+    bootmedia_t media;
+    // Underlying block device.
+    blkdev_t   *dev;
+} bootmedia_blkdev_t;
+
+// Register a block device as boot media.
+// The block device must already be opened using `blkdev_open`.
+void register_blkdev_media(bootmedia_blkdev_t *media, blkdev_t *dev);
@@ -0,0 +1,19 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stdint.h>
+
+// Previous stage to bootloader RAM image magic.
+#define RAMBOOT_MAGIC 0x3ac1e5b7d04f9a62
+
+// RAM image handed over by the previous stage.
+// The image must lie in SRAM below the bootloader, and not overlap any SRAM address it loads to.
+typedef struct {
+    // Magic value, must be `RAMBOOT_MAGIC`.
+    uint64_t magic;
+    // Address of the image in SRAM.
+    uint32_t addr;
+    // Length of the image in bytes.
+    uint32_t length;
+} ramboot_t;
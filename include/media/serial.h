@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "checksum.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Serial boot frame synchronization bytes.
+#define SERIALBOOT_SYNC0     0xa5
+#define SERIALBOOT_SYNC1     0x5a
+// Size of the frame header, including synchronization bytes.
+#define SERIALBOOT_HDR_SIZE  10
+// Maximum serial boot frame payload size; all data frames except the last must be this size.
+#define SERIALBOOT_BLOCK_MAX 1024
+
+// Serial boot frame types.
+typedef enum {
+    // Host to device: start of image, payload is the 32-bit image length.
+    SERIALBOOT_START = 1,
+    // Host to device: image data, index is the block number.
+    SERIALBOOT_DATA,
+    // Host to device: end of image.
+    SERIALBOOT_END,
+    // Host to device: abort serial boot and continue normal boot.
+    SERIALBOOT_ABORT,
+    // Device to host: index is the next expected block number.
+    SERIALBOOT_ACK,
+    // Device to host: image rejected, index is a `serialboot_err_t`.
+    SERIALBOOT_ERROR,
+} serialboot_type_t;
+
+// Serial boot error codes.
+typedef enum {
+    // Image does not fit the receive window.
+    SERIALBOOT_ERR_TOOLARGE = 1,
+    // Frame received outside of a transfer.
+    SERIALBOOT_ERR_NOSTART,
+} serialboot_err_t;
+
+// Serial boot frame receive states.
+typedef enum {
+    SERIALBOOT_RX_SYNC0,
+    SERIALBOOT_RX_SYNC1,
+    SERIALBOOT_RX_HEADER,
+    SERIALBOOT_RX_PAYLOAD,
+    SERIALBOOT_RX_CRC,
+} serialboot_rx_state_t;
+
+// Serial boot frame receiver.
+// On the wire, a frame is: sync0, sync1, type, reserved, index (u32 LE), length (u16 LE), payload, CRC32 (u32 LE).
+// The CRC32 covers everything from the type up to and including the payload.
+typedef struct {
+    // Current receive state.
+    serialboot_rx_state_t state;
+    // Byte position within the current state.
+    size_t                pos;
+    // Running CRC32 of the frame.
+    crc32_t               crc;
+    // Received CRC32 of the frame.
+    uint32_t              rx_crc;
+    // Number of frames dropped due to bad length or CRC.
+    uint32_t              dropped;
+    // Frame type.
+    uint8_t               type;
+    // Frame index.
+    uint32_t              index;
+    // Frame payload length.
+    uint16_t              length;
+    // Frame payload.
+    uint8_t               payload[SERIALBOOT_BLOCK_MAX];
+} serialboot_rx_t;
+
+// Reset a serial boot frame receiver.
+void   serialboot_rx_init(serialboot_rx_t *rx);
+// Feed one byte into a serial boot frame receiver.
+// Returns true when a complete frame with a valid CRC was received.
+bool   serialboot_rx_byte(serialboot_rx_t *rx, uint8_t byte);
+// Encode a payload-less serial boot frame into `buf`.
+// Returns the frame length.
+size_t serialboot_encode(uint8_t buf[SERIALBOOT_HDR_SIZE + 4], serialboot_type_t type, uint32_t index);
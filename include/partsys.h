@@ -26,6 +26,20 @@ typedef struct partsys partsys_t;
 
 
 
+// Filesystem a partition is expected to hold, as far as the partition system knows.
+typedef enum {
+    // Unknown; every filesystem type is probed.
+    PART_FS_UNKNOWN,
+    // Raw image without a filesystem.
+    PART_FS_RAW,
+    // AppFS filesystem.
+    PART_FS_APPFS,
+    // FAT filesystem.
+    PART_FS_FAT,
+    // LittleFS filesystem.
+    PART_FS_LITTLEFS,
+} part_fs_t;
+
 // Partition information.
 typedef struct partition partition_t;
 // Partition information.
@@ -46,6 +60,8 @@ struct partition {
     size_t    prio;
     // Partition name.
     char      name[PART_NAME_MAX + 1];
+    // Expected filesystem.
+    part_fs_t fs_hint;
 };
 
 typedef diskoff_t (*partsys_ident_t)(bootmedia_t *media);
@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef HAS_PROFILE
+
+// Number of histogram buckets; bucket `n` counts calls of 2^n to 2^(n+1)-1 cycles.
+#define PROFILE_BUCKETS 32
+
+// Profiled code region.
+typedef struct profile_region profile_region_t;
+// Running measurement of a profiled region.
+typedef struct profile_scope  profile_scope_t;
+
+// Profiled code region.
+struct profile_region {
+    // Next registered region.
+    profile_region_t *next;
+    // Region name.
+    char const       *name;
+    // Whether this region is in the region list.
+    bool              registered;
+    // Number of completed calls.
+    uint32_t          calls;
+    // Total cycles.
+    uint64_t          cycles;
+    // Total retired instructions.
+    uint64_t          instret;
+    // Least cycles of a single call.
+    uint32_t          min;
+    // Most cycles of a single call.
+    uint32_t          max;
+    // Histogram of cycles per call.
+    uint32_t          hist[PROFILE_BUCKETS];
+};
+
+// Running measurement of a profiled region.
+struct profile_scope {
+    // Region measured, or NULL if not measuring.
+    profile_region_t *region;
+    // Cycle counter at entry.
+    uint32_t          cycles;
+    // Instruction counter at entry.
+    uint32_t          instret;
+};
+
+// Start measuring a region.
+profile_scope_t profile_enter(profile_region_t *region);
+// Stop measuring a region and add the measurement to its statistics.
+void            profile_exit(profile_scope_t *scope);
+// Print the statistics and histograms of all regions that were entered.
+void            profile_summary();
+
+// Profile the rest of the enclosing scope as region `id`.
+#define PROFILE_SCOPE(id)                                                                                              \
+    static profile_region_t profile_region_##id = {.name = #id};                                                       \
+    profile_scope_t         profile_scope_##id __attribute__((cleanup(profile_exit)))                                  \
+    = profile_enter(&profile_region_##id)
+// Print the profiler summary.
+#define PROFILE_SUMMARY() profile_summary()
+
+#else
+
+#define PROFILE_SCOPE(id) (void)0
+#define PROFILE_SUMMARY() (void)0
+
+#endif
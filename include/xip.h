@@ -21,6 +21,8 @@ typedef struct {
     bool   enable;
 } xip_range_t;
 
+// Initialise the XIP MMU table shadow.
+void        xip_init();
 // Get XIP base address.
 size_t      xip_map_base();
 // Detect XIP size, if any.
@@ -4,10 +4,20 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 
+// Bring up the clocks before the C runtime is initialized.
+// Runs before `.bss` is cleared and before constructors, so it must not use either.
+void port_clock_init();
 // Perform early initialization of the port-specific hardware.
 void port_early_init();
 // Perform full initialization of the port-specific hardware.
 void port_init();
 // Pre-control handover checks and settings.
 bool port_pre_handover();
+// Microseconds since the bootloader was entered.
+uint32_t port_startup_us();
+// Whether the serial download boot mode is requested.
+bool port_serialboot_requested();
+// Read a 256-bit key from eFuse key block `block` (0-5).
+bool port_efuse_read_key(int block, uint8_t key[32]);
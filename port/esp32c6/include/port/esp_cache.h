@@ -29,3 +29,9 @@ bool esp_cache_flush(size_t addr, size_t len);
 bool esp_cache_flush_all();
 // Query whether the cache is enabled.
 bool esp_cache_is_enabled();
+#ifdef HAS_ESP_PRELOAD
+// Queue an instruction cache preload of a mapped range; the first one starts right away.
+bool esp_cache_preload(size_t addr, size_t len);
+// Finish all queued preloads.
+void esp_cache_preload_wait();
+#endif
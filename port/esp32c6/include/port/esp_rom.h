@@ -24,3 +24,10 @@ uint32_t Cache_Get_DCache_Line_Size();
 // Invalidate a range of instruction and/or data cache.
 // Returns 0 on success, 1 on error.
 int      Cache_Invalidate_Addr(uint32_t address, uint32_t length);
+// ROM function: Start a manual instruction cache preload of up to the cache size, suspending autoload.
+// Returns whether autoload was enabled.
+uint32_t Cache_Start_ICache_Preload(uint32_t addr, uint32_t size, uint32_t order);
+// ROM function: Query whether the manual instruction cache preload is done.
+uint32_t Cache_ICache_Preload_Done();
+// ROM function: End the manual instruction cache preload and restore autoload.
+void     Cache_End_ICache_Preload(uint32_t autoload);
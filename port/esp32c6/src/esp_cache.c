@@ -7,13 +7,22 @@
 #include "port/esp_rom.h"
 #include "port/hardware.h"
 #include "port/reg/esp_extmem.h"
+#include "profile.h"
+#include "xip.h"
+
+#ifdef HAS_PROFILE
+#include "cpu/counters.h"
+#endif
 
 // Shared cache for instruction and data.
 #define SOC_SHARED_IDCACHE_SUPPORTED  true
 // Cache supports freeze operation.
 #define SOC_CACHE_FREEZE_SUPPORTED    true
 // Cache supports invalidation.
-#define SOC_CACHE_INALIDATE_SUPPORTED false
+#define SOC_CACHE_INALIDATE_SUPPORTED true
+// Total cache size; ranges at least this large are invalidated entirely.
+// Walking more lines than the cache can hold costs more than dropping all of it.
+#define SOC_CACHE_SIZE                (32 * 1024)
 
 #define EXTMEM (*(extmem_t *)EXTMEM_BASE)
 
@@ -29,6 +38,36 @@ static uint32_t dcache_autoload;
 static size_t line_size;
 // Whether cache is enabled.
 static bool   enabled;
+#if SOC_CACHE_INALIDATE_SUPPORTED
+// Whether a failed range invalidation was reported.
+static bool   range_failed;
+#endif
+
+#ifdef HAS_ESP_PRELOAD
+// Maximum number of queued preload ranges.
+#define ESP_PRELOAD_MAX 8
+
+// Queued preload range.
+typedef struct {
+    // Virtual start address.
+    size_t addr;
+    // Length in bytes.
+    size_t len;
+} preload_range_t;
+
+// Queued preload ranges; the first one is running.
+static preload_range_t preload_queue[ESP_PRELOAD_MAX];
+// Number of queued preload ranges.
+static size_t          preload_count;
+// Total bytes queued for preload.
+static size_t          preload_bytes;
+// Autoload state to restore after the running preload.
+static uint32_t        preload_autoload;
+#endif
+
+#ifdef HAS_PROFILE
+static void esp_cache_benchmark();
+#endif
 
 // Initialise the cache HAL.
 void esp_cache_init() {
@@ -47,6 +86,10 @@ void esp_cache_init() {
 
     // Query cache line size.
     line_size = Cache_Get_ICache_Line_Size();
+
+#ifdef HAS_PROFILE
+    esp_cache_benchmark();
+#endif
 }
 
 // Disable caches.
@@ -67,10 +110,33 @@ void esp_cache_enable() {
     enabled = true;
 }
 
+#if SOC_CACHE_INALIDATE_SUPPORTED
+// Invalidate the cache lines of a virtual address range.
+static bool esp_cache_invalidate_range(size_t addr, size_t len) {
+    // Round out to whole cache lines.
+    size_t start = addr & ~(line_size - 1);
+    size_t end   = (addr + len + line_size - 1) & ~(line_size - 1);
+    return !Cache_Invalidate_Addr(start, end - start);
+}
+#endif
+
 // Try to flush a cache range, if supported.
 bool esp_cache_flush(size_t addr, size_t len) {
 #if SOC_CACHE_INALIDATE_SUPPORTED
-    return !Cache_Invalidate_Addr(addr, len);
+    if (!enabled || len >= SOC_CACHE_SIZE) {
+        return esp_cache_flush_all();
+    }
+    PROFILE_SCOPE(esp_cache_flush);
+    if (esp_cache_invalidate_range(addr, len)) {
+        return true;
+    }
+
+    // The ROM rejected the range; drop the entire cache instead.
+    if (!range_failed) {
+        logkf(LOG_WARN, "Cache range invalidation failed at %{size;x}-%{size;x}", addr, addr + len - 1);
+        range_failed = true;
+    }
+    return esp_cache_flush_all();
 #else
     (void)addr;
     (void)len;
@@ -80,6 +146,7 @@ bool esp_cache_flush(size_t addr, size_t len) {
 
 // Try to flush the entire cache, if supported.
 bool esp_cache_flush_all() {
+    PROFILE_SCOPE(esp_cache_flush_all);
     if (enabled) {
         esp_cache_disable();
         esp_cache_enable();
@@ -91,3 +158,77 @@ bool esp_cache_flush_all() {
 bool esp_cache_is_enabled() {
     return true;
 }
+
+#ifdef HAS_ESP_PRELOAD
+// Queue an instruction cache preload of a mapped range; the first one starts right away.
+bool esp_cache_preload(size_t addr, size_t len) {
+    // Anything past the cache size would only evict what was preloaded before it.
+    if (!enabled || !len || preload_count >= ESP_PRELOAD_MAX || preload_bytes + len > SOC_CACHE_SIZE) {
+        return false;
+    }
+    preload_queue[preload_count++]  = (preload_range_t){addr, len};
+    preload_bytes                  += len;
+    if (preload_count == 1) {
+        preload_autoload = Cache_Start_ICache_Preload(addr, len, 0);
+    }
+    return true;
+}
+
+// Finish all queued preloads.
+void esp_cache_preload_wait() {
+    // The ROM runs one manual preload at a time, so the rest are started as each one completes.
+    for (size_t i = 0; i < preload_count; i++) {
+        if (i) {
+            preload_autoload = Cache_Start_ICache_Preload(preload_queue[i].addr, preload_queue[i].len, 0);
+        }
+        while (!Cache_ICache_Preload_Done()) continue;
+        Cache_End_ICache_Preload(preload_autoload);
+    }
+    preload_count = 0;
+    preload_bytes = 0;
+}
+#endif
+
+#ifdef HAS_PROFILE
+// Number of flushes per method in `esp_cache_benchmark`.
+#define ESP_CACHE_BENCHMARK_CALLS 16
+
+// Measure and log the cost of invalidating the cache after a remap.
+static void esp_cache_benchmark() {
+    size_t base = xip_map_base();
+    size_t page = xip_get_page_size();
+
+    uint32_t start = cpu_cycles();
+    for (int i = 0; i < ESP_CACHE_BENCHMARK_CALLS; i++) {
+        esp_cache_flush_all();
+    }
+    uint32_t full = cpu_cycles() - start;
+
+#if SOC_CACHE_INALIDATE_SUPPORTED
+    start = cpu_cycles();
+    for (int i = 0; i < ESP_CACHE_BENCHMARK_CALLS; i++) {
+        esp_cache_invalidate_range(base, page);
+    }
+    uint32_t range_page = cpu_cycles() - start;
+
+    start = cpu_cycles();
+    for (int i = 0; i < ESP_CACHE_BENCHMARK_CALLS; i++) {
+        esp_cache_invalidate_range(base, line_size);
+    }
+    uint32_t range_line = cpu_cycles() - start;
+
+    logkf(
+        LOG_INFO,
+        "Cache flush cost per remap: full %{u32;d}, %{size;d}-byte page %{u32;d}, one line %{u32;d} cycles",
+        full / ESP_CACHE_BENCHMARK_CALLS,
+        page,
+        range_page / ESP_CACHE_BENCHMARK_CALLS,
+        range_line / ESP_CACHE_BENCHMARK_CALLS
+    );
+#else
+    (void)base;
+    (void)page;
+    logkf(LOG_INFO, "Cache flush cost per remap: full %{u32;d} cycles", full / ESP_CACHE_BENCHMARK_CALLS);
+#endif
+}
+#endif
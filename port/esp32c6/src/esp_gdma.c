@@ -0,0 +1,168 @@
+// SPDX-License-Identifier: MIT
+
+#ifdef HAS_DMA_COPY
+
+#include "badge_strings.h"
+#include "dma.h"
+#include "memmap.h"
+#include "soc/gdma_struct.h"
+#include "soc/pcr_struct.h"
+
+// GDMA channel used for memory copies.
+#define GDMA_COPY_CH    0
+// Peripheral ID for memory-to-memory transfers; any ID not assigned to a peripheral.
+#define GDMA_COPY_PERI  1
+// Largest buffer of a single descriptor, rounded down to a whole word.
+#define GDMA_DESC_MAX   4092
+// Descriptors per direction, which limits how much is copied per transfer.
+#define GDMA_DESC_COUNT 8
+
+
+
+// GDMA linked list descriptor.
+typedef struct gdma_desc gdma_desc_t;
+struct gdma_desc {
+    // Buffer size.
+    uint32_t     size    : 12;
+    // Number of valid bytes in the buffer.
+    uint32_t     length  : 12;
+    uint32_t             : 4;
+    // Receive error.
+    uint32_t     err_eof : 1;
+    uint32_t             : 1;
+    // Last descriptor of a transfer.
+    uint32_t     suc_eof : 1;
+    // Descriptor is owned by the DMA.
+    uint32_t     owner   : 1;
+    // Buffer address.
+    void        *buffer;
+    // Next descriptor, or NULL.
+    gdma_desc_t *next;
+};
+
+// Transmit descriptors; read from the source.
+static gdma_desc_t    out_desc[GDMA_DESC_COUNT];
+// Receive descriptors; written to the destination.
+static gdma_desc_t    in_desc[GDMA_DESC_COUNT];
+// Whether the channel has been set up.
+static bool           gdma_ready;
+// Whether a transfer is running.
+static bool           gdma_busy;
+// Destination of the part of the copy not yet started.
+static uint8_t       *pend_dest;
+// Source of the part of the copy not yet started.
+static uint8_t const *pend_src;
+// Length of the part of the copy not yet started.
+static size_t         pend_len;
+
+// Set up the GDMA channel for memory-to-memory transfers.
+static void gdma_init() {
+    PCR.gdma_conf.gdma_clk_en = true;
+    PCR.gdma_conf.gdma_rst_en = false;
+    GDMA.misc_conf.clk_en     = true;
+
+    gdma_chn_reg_t volatile *ch = &GDMA.channel[GDMA_COPY_CH];
+    ch->in.in_conf0.in_rst      = true;
+    ch->in.in_conf0.in_rst      = false;
+    ch->out.out_conf0.out_rst   = true;
+    ch->out.out_conf0.out_rst   = false;
+
+    // Transfers are polled, not interrupt-driven.
+    GDMA.in_intr[GDMA_COPY_CH].ena.val  = 0;
+    GDMA.out_intr[GDMA_COPY_CH].ena.val = 0;
+    ch->in.in_conf0.mem_trans_en        = true;
+    ch->in.in_peri_sel.peri_in_sel      = GDMA_COPY_PERI;
+    ch->out.out_peri_sel.peri_out_sel   = GDMA_COPY_PERI;
+    ch->in.in_conf0.indscr_burst_en     = true;
+    ch->out.out_conf0.outdscr_burst_en  = true;
+    ch->out.out_conf0.out_eof_mode      = true;
+    gdma_ready                          = true;
+}
+
+// Fill descriptors for `len` bytes at `buf`; at most `GDMA_DESC_COUNT * GDMA_DESC_MAX` bytes.
+static void gdma_build_chain(gdma_desc_t *desc, void *buf, size_t len, bool is_out) {
+    uint8_t *ptr = buf;
+    while (1) {
+        size_t part   = len < GDMA_DESC_MAX ? len : GDMA_DESC_MAX;
+        desc->size    = part;
+        desc->length  = is_out ? part : 0;
+        desc->err_eof = false;
+        desc->suc_eof = is_out && part == len;
+        desc->owner   = true;
+        desc->buffer  = ptr;
+        ptr          += part;
+        len          -= part;
+        if (!len) {
+            desc->next = NULL;
+            return;
+        }
+        desc->next = desc + 1;
+        desc++;
+    }
+}
+
+// Start the next part of the pending copy.
+static void gdma_kick() {
+    size_t len = pend_len < GDMA_DESC_COUNT * GDMA_DESC_MAX ? pend_len : GDMA_DESC_COUNT * GDMA_DESC_MAX;
+    gdma_build_chain(out_desc, (void *)pend_src, len, true);
+    gdma_build_chain(in_desc, pend_dest, len, false);
+    bool aligned  = !(((size_t)pend_dest | (size_t)pend_src | len) & 3);
+    pend_dest    += len;
+    pend_src     += len;
+    pend_len     -= len;
+
+    // The descriptors must be in memory before the DMA reads them.
+    __sync_synchronize();
+    gdma_chn_reg_t volatile *ch         = &GDMA.channel[GDMA_COPY_CH];
+    ch->in.in_conf0.in_data_burst_en    = aligned;
+    ch->out.out_conf0.out_data_burst_en = aligned;
+    GDMA.in_intr[GDMA_COPY_CH].clr.val  = -1;
+    GDMA.out_intr[GDMA_COPY_CH].clr.val = -1;
+    ch->in.in_link.inlink_addr          = (size_t)in_desc;
+    ch->out.out_link.outlink_addr       = (size_t)out_desc;
+    ch->in.in_link.inlink_start         = true;
+    ch->out.out_link.outlink_start      = true;
+    gdma_busy                           = true;
+}
+
+// Start copying `len` bytes from `src` to `dest`, after waiting for the previous copy.
+// Buffers the DMA cannot reach are copied synchronously before this returns.
+void dma_copy_start(void *dest, void const *src, size_t len) {
+    dma_copy_wait();
+    if (!len || dest == src) {
+        return;
+    }
+
+    // GDMA only reaches internal SRAM, not flash, and copies strictly forward.
+    uint8_t       *dest_ptr = dest;
+    uint8_t const *src_ptr  = src;
+    bool           overlap  = dest_ptr < src_ptr + len && src_ptr < dest_ptr + len;
+    if (!IS_SRAM_RANGE(dest, len) || !IS_SRAM_RANGE(src, len) || overlap) {
+        mem_copy(dest, src, len);
+        return;
+    }
+
+    if (!gdma_ready) {
+        gdma_init();
+    }
+    pend_dest = dest_ptr;
+    pend_src  = src_ptr;
+    pend_len  = len;
+    gdma_kick();
+}
+
+// Wait for the last copy started to finish.
+void dma_copy_wait() {
+    while (gdma_busy) {
+        if (!GDMA.in_intr[GDMA_COPY_CH].raw.in_suc_eof_int_raw) {
+            continue;
+        }
+        gdma_busy = false;
+        if (pend_len) {
+            gdma_kick();
+        }
+    }
+    __sync_synchronize();
+}
+
+#endif
@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: MIT
+
+#ifdef HAS_HASH_ESP_SHA
+
+#include "hash.h"
+#include "port/hardware.h"
+#include "soc/pcr_struct.h"
+
+// SHA mode register.
+#define SHA_MODE_REG     (SHA_BASE + 0x00)
+// Start hashing from the initial hash value.
+#define SHA_START_REG    (SHA_BASE + 0x10)
+// Continue hashing from the current hash value.
+#define SHA_CONTINUE_REG (SHA_BASE + 0x14)
+// Busy register.
+#define SHA_BUSY_REG     (SHA_BASE + 0x18)
+// Intermediate hash value, in digest byte order.
+#define SHA_H_MEM        (SHA_BASE + 0x40)
+// Message block, in message byte order.
+#define SHA_M_MEM        (SHA_BASE + 0x80)
+
+// SHA_MODE_REG value for SHA-256.
+#define SHA_MODE_SHA256 2
+
+
+
+// Whether the accelerator is computing a hash.
+static bool claimed;
+// Whether the next block starts from the initial hash value.
+static bool first;
+
+// Wait for the accelerator to finish the last block.
+static inline void esp_sha_wait() {
+    while (READ_REG(SHA_BUSY_REG) & 1) continue;
+}
+
+// Claim the accelerator and start a new hash.
+static bool esp_sha_claim(hash_t *ctx) {
+    (void)ctx;
+    if (claimed) {
+        return false;
+    }
+    if (!PCR.sha_conf.sha_clk_en || PCR.sha_conf.sha_rst_en) {
+        PCR.sha_conf.sha_clk_en = true;
+        PCR.sha_conf.sha_rst_en = false;
+    }
+    esp_sha_wait();
+    WRITE_REG(SHA_MODE_REG, SHA_MODE_SHA256);
+    claimed = true;
+    first   = true;
+    return true;
+}
+
+// Feed whole blocks to the accelerator.
+// Returns as soon as the last block is started, so the caller can fetch more data while it is hashed.
+static void esp_sha_blocks(hash_t *ctx, void const *mem, size_t count) {
+    (void)ctx;
+    uint8_t const *ptr     = mem;
+    bool           aligned = !((size_t)ptr & 3);
+    for (; count; ptr += 64, count--) {
+        // The message registers may only be written while the accelerator is idle.
+        esp_sha_wait();
+        if (aligned) {
+            uint32_t const *words = (uint32_t const *)ptr;
+            for (int i = 0; i < 16; i++) {
+                WRITE_REG(SHA_M_MEM + 4 * i, words[i]);
+            }
+        } else {
+            for (int i = 0; i < 16; i++) {
+                uint32_t word = ptr[4 * i] | (ptr[4 * i + 1] << 8) | (ptr[4 * i + 2] << 16)
+                                | ((uint32_t)ptr[4 * i + 3] << 24);
+                WRITE_REG(SHA_M_MEM + 4 * i, word);
+            }
+        }
+        WRITE_REG(first ? SHA_START_REG : SHA_CONTINUE_REG, 1);
+        first = false;
+    }
+}
+
+// Read the digest and release the accelerator.
+static void esp_sha_finish(hash_t *ctx, uint8_t digest[SHA256_DIGEST_LEN]) {
+    (void)ctx;
+    esp_sha_wait();
+    for (int i = 0; i < SHA256_DIGEST_LEN / 4; i++) {
+        uint32_t word = READ_REG(SHA_H_MEM + 4 * i);
+        for (int j = 0; j < 4; j++) {
+            digest[4 * i + j] = word >> (8 * j);
+        }
+    }
+    claimed = false;
+}
+
+// ESP32-C6 SHA accelerator.
+static hash_engine_t esp_sha_engine = {
+    .name   = "ESP SHA",
+    .claim  = esp_sha_claim,
+    .blocks = esp_sha_blocks,
+    .finish = esp_sha_finish,
+};
+
+// Register the SHA accelerator.
+static void register_esp_sha() __attribute__((constructor));
+static void register_esp_sha() {
+    hash_engine_register(&esp_sha_engine);
+}
+
+#endif
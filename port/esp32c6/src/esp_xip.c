@@ -5,6 +5,7 @@
 #include "port/esp_cache.h"
 #include "port/hardware.h"
 #include "port/reg/esp_spimem.h"
+#include "profile.h"
 #include "xip.h"
 
 #define SOC_MMU_VALID     (1 << 9)
@@ -18,7 +19,52 @@
 extern uint8_t const start_xip[] asm("__start_xip");
 extern uint8_t const stop_xip[] asm("__stop_xip");
 
+// Shadow of the MMU table.
+static uint16_t mmu_table[XIP_PAGE_VIRT_MAX];
+// Last valid entry per page since its cache lines were flushed, or 0 if none can be cached.
+static uint16_t mmu_cached[XIP_PAGE_VIRT_MAX];
+// Bitmap of unmapped virtual pages.
+static uint32_t free_pages[XIP_PAGE_VIRT_MAX / 32];
+// Shadow of the page size.
+static size_t   cur_page_size;
+
+
+
+// Write an MMU entry if it changed.
+// Returns whether the cache lines of the page must be flushed.
+static bool xip_write_entry(size_t index, uint16_t raw) {
+    if (mmu_table[index] != raw) {
+        XIPMEM.mmu_item_index   = index;
+        XIPMEM.mmu_item_content = raw;
+        mmu_table[index]        = raw;
+        if (raw & SOC_MMU_VALID) {
+            free_pages[index / 32] &= ~(1u << index % 32);
+        } else {
+            free_pages[index / 32] |= 1u << index % 32;
+        }
+    }
 
+    // Lines left over from an earlier mapping of the same ROM page are still valid.
+    if (!(raw & SOC_MMU_VALID) || mmu_cached[index] == raw) {
+        return false;
+    }
+    mmu_cached[index] = raw;
+    return true;
+}
+
+// Initialise the MMU table shadow.
+void xip_init() {
+    cur_page_size = 65536 / (1 << XIPMEM.mmu_power_ctrl.mmu_page_size);
+    for (size_t i = 0; i < XIP_PAGE_VIRT_MAX; i++) {
+        XIPMEM.mmu_item_index = i;
+        uint16_t raw          = XIPMEM.mmu_item_content & (SOC_MMU_VALID | SOC_MMU_ADDR_MASK);
+        mmu_table[i]          = raw;
+        mmu_cached[i]         = raw & SOC_MMU_VALID ? raw : 0;
+        if (!(raw & SOC_MMU_VALID)) {
+            free_pages[i / 32] |= 1u << i % 32;
+        }
+    }
+}
 
 // Get XIP base address.
 size_t xip_map_base() {
@@ -37,7 +83,7 @@ size_t xip_rom_size() {
 
 // Get the XIP page size.
 size_t xip_get_page_size() {
-    return 65536 / (1 << XIPMEM.mmu_power_ctrl.mmu_page_size);
+    return cur_page_size;
 }
 
 // Set the XIP page size.
@@ -47,7 +93,14 @@ void xip_set_page_size(size_t size) {
         case 16384: XIPMEM.mmu_power_ctrl.mmu_page_size = 2; break;
         case 32768: XIPMEM.mmu_power_ctrl.mmu_page_size = 1; break;
         case 65536: XIPMEM.mmu_power_ctrl.mmu_page_size = 0; break;
-        default: logkf(LOG_ERROR, "Invalid XIP page size: %{size;d}", size); break;
+        default: logkf(LOG_ERROR, "Invalid XIP page size: %{size;d}", size); return;
+    }
+    if (size != cur_page_size) {
+        // The same entries now map different ROM, so any cached lines are stale.
+        cur_page_size = size;
+        for (size_t i = 0; i < XIP_PAGE_VIRT_MAX; i++) {
+            mmu_cached[i] = 0;
+        }
     }
 }
 
@@ -65,8 +118,7 @@ xip_range_t xip_get(size_t index) {
     }
 
     // Convert to an abstract entry.
-    XIPMEM.mmu_item_index = index;
-    uint32_t raw          = XIPMEM.mmu_item_content;
+    uint32_t raw = mmu_table[index];
     return (xip_range_t){
         .rom_addr = xip_get_page_size() * (raw & SOC_MMU_ADDR_MASK),
         .map_addr = xip_map_base() + xip_get_page_size() * index,
@@ -117,15 +169,17 @@ bool xip_set(size_t index, xip_range_t range) {
     }
 
     // Convert to an MMU entry.
-    XIPMEM.mmu_item_index   = index;
-    XIPMEM.mmu_item_content = (range.rom_addr / xip_get_page_size()) | SOC_MMU_VALID;
-
+    uint16_t raw = range.enable ? (range.rom_addr / xip_get_page_size()) | SOC_MMU_VALID : 0;
+    if (!xip_write_entry(index, raw)) {
+        return true;
+    }
     return esp_cache_flush(range.map_addr, range.length);
 }
 
 // Map an arbitrary page-aligned XIP range.
 // If `override` is false and a region already uses part of the virtual address space, this operation will fail.
 bool xip_map(xip_range_t range, bool override) {
+    PROFILE_SCOPE(xip_map);
     if (!range.enable) {
         logk(LOG_WARN, "Region passed to `xip_map` not enabled");
         return false;
@@ -174,34 +228,41 @@ bool xip_map(xip_range_t range, bool override) {
         range.length += page_size - range.length % page_size;
     }
 
+    size_t first = (range.map_addr - xip_map_base()) / page_size;
+    size_t count = range.length / page_size;
+
     if (!override) {
         // Assert the map is currently empty.
-        for (size_t i = range.map_addr / page_size; i < (range.map_addr + range.length) / page_size; i++) {
-            XIPMEM.mmu_item_index = i;
-            if (XIPMEM.mmu_item_content & SOC_MMU_VALID) {
+        for (size_t i = first; i < first + count; i++) {
+            if (mmu_table[i] & SOC_MMU_VALID) {
                 logkf(
                     LOG_ERROR,
                     "Region at vaddr %{size;x}-%{size;x} overlaps with existing page at vaddr %{size;x}-%{size;x}",
                     range.map_addr,
                     range.map_addr + page_size - 1,
-                    i * page_size,
-                    i * page_size + page_size - 1
+                    xip_map_base() + i * page_size,
+                    xip_map_base() + i * page_size + page_size - 1
                 );
                 return false;
             }
         }
     }
 
-    // Update MMU entries.
-    for (size_t i = range.map_addr / page_size, x = range.rom_addr / page_size;
-         i < (range.map_addr + range.length) / page_size;
-         i++, x++) {
-        XIPMEM.mmu_item_index   = i;
-        XIPMEM.mmu_item_content = x | SOC_MMU_VALID;
+    // Update MMU entries, noting which pages need their cache lines flushed.
+    size_t flush_first = SIZE_MAX;
+    size_t flush_last  = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (xip_write_entry(first + i, (range.rom_addr / page_size + i) | SOC_MMU_VALID)) {
+            flush_first = flush_first < i ? flush_first : i;
+            flush_last  = i;
+        }
     }
 
     // Invalidate cache range.
-    return esp_cache_flush(range.map_addr, range.length);
+    if (flush_first == SIZE_MAX) {
+        return true;
+    }
+    return esp_cache_flush(range.map_addr + flush_first * page_size, (flush_last - flush_first + 1) * page_size);
 }
 
 // Unmap an arbitrary page-aligned XIP range.
@@ -223,10 +284,10 @@ bool xip_unmap(size_t vaddr, size_t length) {
         length += page_size - length % page_size;
     }
 
-    // Update MMU entries.
-    for (size_t i = vaddr / page_size; i < (vaddr + length) / page_size; i++) {
-        XIPMEM.mmu_item_index   = i;
-        XIPMEM.mmu_item_content = 0;
+    // Update MMU entries; cache lines of unmapped pages are flushed when they are mapped to other ROM.
+    size_t first = (vaddr - xip_map_base()) / page_size;
+    for (size_t i = first; i < first + length / page_size; i++) {
+        xip_write_entry(i, 0);
     }
 
     return true;
@@ -235,10 +296,11 @@ bool xip_unmap(size_t vaddr, size_t length) {
 // Get an available virtual address.
 // Returns 0 if there are no more free addresses.
 size_t xip_find_vaddr() {
-    for (ptrdiff_t i = XIP_PAGE_VIRT_MAX - 1; i >= 0; i--) {
-        XIPMEM.mmu_item_index = i;
-        if (!(XIPMEM.mmu_item_content & SOC_MMU_VALID)) {
-            return xip_map_base() + (size_t)i * xip_get_page_size();
+    // Temporary pages are taken from the top, away from where kernels are mapped.
+    for (ptrdiff_t i = XIP_PAGE_VIRT_MAX / 32 - 1; i >= 0; i--) {
+        if (free_pages[i]) {
+            size_t index = (size_t)i * 32 + 31 - __builtin_clz(free_pages[i]);
+            return xip_map_base() + index * xip_get_page_size();
         }
     }
     return 0;
@@ -251,8 +313,7 @@ void xip_dump() {
     logkf(LOG_DEBUG, "XIP mapping:");
     for (size_t i = 0; i < xip_regions(); i++) {
         // Read MMU entry.
-        XIPMEM.mmu_item_index = i;
-        uint32_t raw          = XIPMEM.mmu_item_content;
+        uint32_t raw = mmu_table[i];
         if (!(raw & SOC_MMU_VALID))
             continue;
 
@@ -92,6 +92,9 @@ void __interrupt_handler() {
     switch (mcause) {
         case INT_CHANNEL_TIMER_ALARM: timer_isr_timer_alarm(); break;
         case INT_CHANNEL_WATCHDOG_ALARM: timer_isr_watchdog_alarm(); break;
+#ifdef HAS_LOG_DRAIN
+        case INT_CHANNEL_UART: rawprint_isr(); break;
+#endif
         default: __builtin_unreachable();
     }
 
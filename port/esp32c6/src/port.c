@@ -3,10 +3,13 @@
 
 #include "port.h"
 
+#include "cpu/counters.h"
 #include "modem/modem_lpcon_struct.h"
 #include "modem/modem_syscon_struct.h"
 #include "port/esp_cache.h"
 #include "port/hardware.h"
+#include "port/interrupt.h"
+#include "rawprint.h"
 #include "soc/lp_aon_struct.h"
 #include "soc/lp_clkrst_struct.h"
 #include "soc/lp_timer_struct.h"
@@ -16,6 +19,7 @@
 #include "soc/regi2c_bbpll.h"
 #include "soc/regi2c_defs.h"
 #include "soc/timer_group_struct.h"
+#include "xip.h"
 
 #define PMU_MODE_HP_ACTIVE 0
 #define PMU_MODE_HP_MODEM  1
@@ -23,6 +27,31 @@
 #define PMU_MODE_LP_ACTIVE 0
 #define PMU_MODE_LP_SLEEP  1
 
+// Time the RC_FAST oscillator needs to start up.
+#define C6_FOSC_STARTUP_US    100
+// Time the RTC fast clock needs to settle after switching its source (SOC_DELAY_RTC_FAST_CLK_SWITCH).
+#define C6_FAST_CLK_SWITCH_US 3
+// Time the RTC slow clock needs to settle after switching its source (SOC_DELAY_RTC_SLOW_CLK_SWITCH).
+#define C6_SLOW_CLK_SWITCH_US 300
+// Crystal frequency; the CPU runs from it until the PLL is selected.
+#define C6_XTAL_FREQ_MHZ      40
+
+#ifndef SERIALBOOT_GPIO
+// GPIO that requests serial download boot when held low at reset.
+// Not GPIO9 (BOOT button), GPIO8 or GPIO15: holding a strapping pin at reset changes the ROM boot mode instead.
+#define SERIALBOOT_GPIO 2
+#endif
+
+
+
+// Clock bring-up timing; in `.data`, not `.bss`, because it is written before `.bss` is cleared.
+static struct {
+    // Cycle count at which the RTC slow clock has settled.
+    uint32_t slow_clk_ready;
+    // Cycle count at which the CPU switched to the PLL.
+    uint32_t pll_cycles;
+} clock_timing = {UINT32_MAX, UINT32_MAX};
+
 
 
 uint8_t esp_rom_regi2c_read(uint8_t block, uint8_t host_id, uint8_t reg_add);
@@ -87,6 +116,10 @@ static void c6_enable_pll() {
 
 // Initialize ESP32C6 clocks.
 static void c6_init_clocks() {
+    // Start the RC_FAST oscillator first; it gets the PLL bring-up as time to settle.
+    PMU.lp_sys[PMU_MODE_LP_ACTIVE].clk_power.xpd_fosc = true;
+    uint32_t fosc_start                               = cpu_cycles();
+
     PMU.hp_sys[PMU_MODE_HP_ACTIVE].icg_modem.code       = 2;
     MODEM_SYSCON.clk_conf_power_st.clk_modem_apb_st_map = BIT(2);
     MODEM_LPCON.clk_conf_power_st.clk_i2c_mst_st_map    = BIT(2);
@@ -104,15 +137,19 @@ static void c6_init_clocks() {
     // Set CPU clock to PLL at 160MHz.
     PCR.cpu_freq_conf.cpu_hs_div_num = 0;
     PCR.sysclk_conf.soc_clk_sel      = 1;
+    clock_timing.pll_cycles          = cpu_cycles();
     esp_rom_set_cpu_ticks_per_us(160);
 
-    // Select RTC clock sources.
-    PMU.lp_sys[PMU_MODE_LP_ACTIVE].clk_power.xpd_fosc = true;
-    esp_rom_delay_us(100);
+    // Select RTC clock sources once RC_FAST is stable.
+    // Some of the elapsed cycles ran at the slower crystal clock, so counting them at 160MHz never waits too short.
+    // None of these have a ready bit to poll, so the settle times are cycle deadlines instead of fixed delays.
+    while (cpu_cycles() - fosc_start < C6_FOSC_STARTUP_US * 160) continue;
     LP_CLKRST.lp_clk_conf.fast_clk_sel = 0;
-    esp_rom_delay_us(100);
+    uint32_t fast_start                = cpu_cycles();
+    while (cpu_cycles() - fast_start < C6_FAST_CLK_SWITCH_US * 160) continue;
     LP_CLKRST.lp_clk_conf.slow_clk_sel = 0;
-    esp_rom_delay_us(100);
+    // Nothing needs the slow clock until the watchdogs are set up; `.bss` is cleared in the meantime.
+    clock_timing.slow_clk_ready = cpu_cycles() + C6_SLOW_CLK_SWITCH_US * 160;
 }
 
 // Initialize ESP32C6 watchdogs.
@@ -127,15 +164,60 @@ static void c6_init_watchdog() {
     TIMERG1.wdtconfig0.wdt_en          = 0;
 }
 
+// Bring up the clocks before the C runtime is initialized.
+// Runs before `.bss` is cleared and before constructors, so it must not use either.
+void port_clock_init() {
+    cpu_counters_init();
+    c6_init_clocks();
+}
+
 // Perform early initialization of the port-specific hardware.
 void port_early_init() {
+    // The watchdogs run from the RTC slow clock.
+    while ((int32_t)(cpu_cycles() - clock_timing.slow_clk_ready) < 0) continue;
     c6_init_watchdog();
-    c6_init_clocks();
 }
 
 // Perform full initialization of the port-specific hardware.
 void port_init() {
+    xip_init();
     esp_cache_init();
+#ifdef HAS_LOG_DRAIN
+    // Log output is sent by interrupts from here on.
+    rawprint_async_start();
+    interrupt_enable();
+#endif
+}
+
+// Microseconds since the bootloader was entered, from the cycle counter started by `port_clock_init`.
+uint32_t port_startup_us() {
+    // Cycles before the PLL switch ran at the crystal frequency.
+    return clock_timing.pll_cycles / C6_XTAL_FREQ_MHZ + (cpu_cycles() - clock_timing.pll_cycles) / 160;
+}
+
+// Whether the serial download boot mode is requested.
+bool port_serialboot_requested() {
+    // Enable input with pull-up on the GPIO.
+    size_t iomux = IOMUX_BASE + 4 + 4 * SERIALBOOT_GPIO;
+    WRITE_REG(iomux, READ_REG(iomux) | BIT(8) | BIT(9));
+    esp_rom_delay_us(10);
+    return !(READ_REG(GPIOMTX_BASE + 0x3c) & BIT(SERIALBOOT_GPIO));
+}
+
+// Read a 256-bit key from eFuse key block `block` (0-5).
+bool port_efuse_read_key(int block, uint8_t key[32]) {
+    if (block < 0 || block > 5) {
+        return false;
+    }
+    // The key blocks are 32 bytes apart, starting at EFUSE_RD_KEY0_DATA0.
+    size_t base = EFUSE_BASE + 0x9c + 0x20 * block;
+    for (int i = 0; i < 8; i++) {
+        uint32_t word = READ_REG(base + 4 * i);
+        for (int j = 0; j < 4; j++) {
+            key[4 * i + j] = word >> (8 * j);
+        }
+    }
+    return true;
 }
 
 // Pre-control handover checks and settings.
@@ -143,6 +225,11 @@ bool port_pre_handover() {
     // Send ESP-IDF information about clocks.
     LP_AON.store[4].val = ESP_RTC_FREQ_MHZ * 0x00010001;
 
+#ifdef HAS_LOG_DRAIN
+    // Get all log output out while its interrupts still work.
+    rawprint_async_stop();
+#endif
+
     // Disable interrupts.
 #ifdef __riscv
     asm("csrci mstatus, 8");
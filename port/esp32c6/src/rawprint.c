@@ -5,10 +5,64 @@
 
 #include "num_to_str.h"
 #include "port/hardware.h"
+#include "port/hardware_allocation.h"
+#include "port/interrupt.h"
+#include "port/intmtx.h"
 #include "time.h"
 
 #include <stddef.h>
 
+// USB-Serial-JTAG endpoint 1 FIFO.
+#define USB_EP1                 0x00
+// USB-Serial-JTAG endpoint 1 status.
+#define USB_EP1_CONF            0x04
+// USB-Serial-JTAG interrupt status.
+#define USB_INT_ST              0x0c
+// USB-Serial-JTAG interrupt enable.
+#define USB_INT_ENA             0x10
+// USB-Serial-JTAG interrupt clear.
+#define USB_INT_CLR             0x14
+// Send the bytes in the IN FIFO.
+#define USB_EP1_WR_DONE         0x01
+// IN FIFO has space.
+#define USB_EP1_FREE            0x02
+// OUT FIFO has data.
+#define USB_EP1_AVAIL           0x04
+// IN FIFO has been emptied by the host.
+#define USB_INT_SERIAL_IN_EMPTY 0x08
+
+// UART FIFO.
+#define UART_FIFO             0x00
+// UART interrupt status.
+#define UART_INT_ST           0x08
+// UART interrupt enable.
+#define UART_INT_ENA          0x0c
+// UART interrupt clear.
+#define UART_INT_CLR          0x10
+// UART FIFO status.
+#define UART_STATUS           0x1c
+// UART FIFO thresholds.
+#define UART_CONF1            0x24
+// UART state machine status.
+#define UART_FSM_STATUS       0x70
+// TX FIFO below threshold.
+#define UART_INT_TXFIFO_EMPTY 0x02
+// UART FIFO depth.
+#define UART_FIFO_LEN         128
+
+#ifdef HAS_LOG_DRAIN
+#ifndef LOG_RING_SIZE
+// Size of the log ring; must be a power of two.
+#define LOG_RING_SIZE 2048
+#endif
+// Log ring reader for the USB-Serial-JTAG.
+#define LOG_DEV_USB   0
+// Log ring reader for the UART.
+#define LOG_DEV_UART  1
+// Number of log ring readers.
+#define LOG_DEV_COUNT 2
+#endif
+
 char const hextab[] = "0123456789ABCDEF";
 
 // Simple printer with specified length.
@@ -55,17 +109,209 @@ void rawprint(char const *msg) {
     }
 }
 
+// Whether the USB-Serial-JTAG host stopped reading.
+static bool discon = false;
+
+#ifdef HAS_LOG_DRAIN
+// Log ring; written by `rawputc`, drained to each output device by its TX interrupt.
+static char              log_ring[LOG_RING_SIZE];
+// Write index of the log ring.
+static uint32_t volatile log_head;
+// Read index of the log ring for each output device.
+static uint32_t volatile log_tail[LOG_DEV_COUNT];
+// Whether the TX interrupt of each output device is disabled because it has nothing to send.
+static bool volatile     log_idle[LOG_DEV_COUNT];
+// Whether output goes through the log ring.
+static bool              log_async;
+
+// Move as much of the log ring to the USB-Serial-JTAG FIFO as fits.
+// Returns whether everything has been sent.
+static bool log_drain_usb() {
+    uint32_t head = log_head;
+    uint32_t tail = log_tail[LOG_DEV_USB];
+    discon       &= !(READ_REG(USB_JTAG_BASE + USB_EP1_CONF) & USB_EP1_FREE);
+    if (discon) {
+        // Nobody is listening; drop the output instead of stalling the ring.
+        tail = head;
+    }
+    if (tail != head) {
+        while (tail != head && (READ_REG(USB_JTAG_BASE + USB_EP1_CONF) & USB_EP1_FREE)) {
+            WRITE_REG(USB_JTAG_BASE + USB_EP1, log_ring[tail % LOG_RING_SIZE]);
+            tail++;
+        }
+        WRITE_REG(USB_JTAG_BASE + USB_EP1_CONF, USB_EP1_WR_DONE);
+    }
+    log_tail[LOG_DEV_USB] = tail;
+    return tail == head;
+}
+
+// Move as much of the log ring to the UART FIFO as fits.
+// Returns whether everything has been sent.
+static bool log_drain_uart() {
+    uint32_t head = log_head;
+    uint32_t tail = log_tail[LOG_DEV_UART];
+    uint32_t fill = (READ_REG(UART0_BASE + UART_STATUS) >> 16) & 0xff;
+    for (; tail != head && fill < UART_FIFO_LEN; fill++, tail++) {
+        WRITE_REG(UART0_BASE + UART_FIFO, log_ring[tail % LOG_RING_SIZE]);
+    }
+    log_tail[LOG_DEV_UART] = tail;
+    return tail == head;
+}
+
+// Drain the log ring by polling; used when it is full and to flush it.
+// Must be called with interrupts disabled.
+static void log_drain_all() {
+    timestamp_us_t timeout = time_us() + 5000;
+    bool           usb     = false;
+    bool           uart    = false;
+    while (!usb || !uart) {
+        usb  = log_drain_usb();
+        uart = log_drain_uart();
+        if (!usb && time_us() > timeout) {
+            discon = true;
+        }
+    }
+}
+
+// Enable the TX interrupts of devices that went idle.
+static void log_wake() {
+    if (log_idle[LOG_DEV_USB]) {
+        log_idle[LOG_DEV_USB] = false;
+        WRITE_REG(USB_JTAG_BASE + USB_INT_ENA, USB_INT_SERIAL_IN_EMPTY);
+    }
+    if (log_idle[LOG_DEV_UART]) {
+        log_idle[LOG_DEV_UART] = false;
+        WRITE_REG(UART0_BASE + UART_INT_ENA, UART_INT_TXFIFO_EMPTY);
+    }
+}
+
+// Start draining output from a ring buffer by interrupts.
+void rawprint_async_start() {
+    bool mie = interrupt_disable();
+
+    // Interrupt when the UART FIFO is down to a quarter.
+    uint32_t conf1 = READ_REG(UART0_BASE + UART_CONF1) & ~(0xff << 8);
+    WRITE_REG(UART0_BASE + UART_CONF1, conf1 | ((UART_FIFO_LEN / 4) << 8));
+    WRITE_REG(USB_JTAG_BASE + USB_INT_ENA, 0);
+    WRITE_REG(UART0_BASE + UART_INT_ENA, 0);
+    WRITE_REG(USB_JTAG_BASE + USB_INT_CLR, USB_INT_SERIAL_IN_EMPTY);
+    WRITE_REG(UART0_BASE + UART_INT_CLR, UART_INT_TXFIFO_EMPTY);
+
+    // Both devices share one interrupt channel.
+    intmtx_route(INTMTX_CORE0_USB_INTR_MAP_REG, INT_CHANNEL_UART);
+    intmtx_route(INTMTX_CORE0_UART0_INTR_MAP_REG, INT_CHANNEL_UART);
+    intmtx_enable(INT_CHANNEL_UART);
+
+    log_head               = 0;
+    log_tail[LOG_DEV_USB]  = 0;
+    log_tail[LOG_DEV_UART] = 0;
+    log_idle[LOG_DEV_USB]  = true;
+    log_idle[LOG_DEV_UART] = true;
+    log_async              = true;
+
+    if (mie) {
+        interrupt_enable();
+    }
+}
+
+// Flush buffered output and return to synchronous output.
+// Everything logged before this is on the wire when it returns.
+void rawprint_async_stop() {
+    if (!log_async) {
+        return;
+    }
+    bool mie = interrupt_disable();
+    log_drain_all();
+    log_async = false;
+
+    WRITE_REG(USB_JTAG_BASE + USB_INT_ENA, 0);
+    WRITE_REG(UART0_BASE + UART_INT_ENA, 0);
+    intmtx_disable(INT_CHANNEL_UART);
+    intmtx_route(INTMTX_CORE0_USB_INTR_MAP_REG, 0);
+    intmtx_route(INTMTX_CORE0_UART0_INTR_MAP_REG, 0);
+
+    // Wait for the UART to shift out its FIFO.
+    while ((READ_REG(UART0_BASE + UART_STATUS) >> 16) & 0xff) continue;
+    while ((READ_REG(UART0_BASE + UART_FSM_STATUS) >> 4) & 0xf) continue;
+
+    if (mie) {
+        interrupt_enable();
+    }
+}
+
+// Callback to the output driver for when an output device interrupt fires.
+void rawprint_isr() {
+    if (READ_REG(USB_JTAG_BASE + USB_INT_ST) & USB_INT_SERIAL_IN_EMPTY) {
+        WRITE_REG(USB_JTAG_BASE + USB_INT_CLR, USB_INT_SERIAL_IN_EMPTY);
+        if (log_drain_usb()) {
+            WRITE_REG(USB_JTAG_BASE + USB_INT_ENA, 0);
+            log_idle[LOG_DEV_USB] = true;
+        }
+    }
+    if (READ_REG(UART0_BASE + UART_INT_ST) & UART_INT_TXFIFO_EMPTY) {
+        WRITE_REG(UART0_BASE + UART_INT_CLR, UART_INT_TXFIFO_EMPTY);
+        if (log_drain_uart()) {
+            WRITE_REG(UART0_BASE + UART_INT_ENA, 0);
+            log_idle[LOG_DEV_UART] = true;
+        }
+    }
+}
+#endif
+
 // Simple printer.
 void rawputc(char msg) {
-    static bool    discon   = false;
-    timestamp_us_t timeout  = time_us() + 5000;
-    discon                 &= !(READ_REG(USB_JTAG_BASE + 4) & 2);
-    while (!discon && !(READ_REG(USB_JTAG_BASE + 4) & 2)) {
+#ifdef HAS_LOG_DRAIN
+    if (log_async) {
+        bool mie = interrupt_disable();
+        // Make room by polling if a device fell a whole ring behind.
+        uint32_t head = log_head;
+        if (head - log_tail[LOG_DEV_USB] >= LOG_RING_SIZE || head - log_tail[LOG_DEV_UART] >= LOG_RING_SIZE) {
+            log_drain_all();
+        }
+        log_ring[log_head % LOG_RING_SIZE] = msg;
+        log_head++;
+        log_wake();
+        if (mie) {
+            interrupt_enable();
+        }
+        return;
+    }
+#endif
+
+    timestamp_us_t timeout = time_us() + 5000;
+    discon                &= !(READ_REG(USB_JTAG_BASE + USB_EP1_CONF) & USB_EP1_FREE);
+    while (!discon && !(READ_REG(USB_JTAG_BASE + USB_EP1_CONF) & USB_EP1_FREE)) {
         if (time_us() > timeout)
             discon = true;
     }
-    WRITE_REG(USB_JTAG_BASE, msg);
-    WRITE_REG(UART0_BASE, msg);
+    WRITE_REG(USB_JTAG_BASE + USB_EP1, msg);
+    WRITE_REG(UART0_BASE + UART_FIFO, msg);
+}
+
+// Simple non-blocking reader.
+// Returns -1 if no character is available.
+int rawgetc() {
+    if (READ_REG(USB_JTAG_BASE + USB_EP1_CONF) & USB_EP1_AVAIL) {
+        return (uint8_t)READ_REG(USB_JTAG_BASE + USB_EP1);
+    }
+    if (READ_REG(UART0_BASE + UART_STATUS) & 0xff) {
+        return (uint8_t)READ_REG(UART0_BASE + UART_FIFO);
+    }
+    return -1;
+}
+
+// Flush characters buffered by the output device.
+void rawflush() {
+#ifdef HAS_LOG_DRAIN
+    if (log_async) {
+        bool mie = interrupt_disable();
+        log_drain_all();
+        if (mie) {
+            interrupt_enable();
+        }
+    }
+#endif
+    WRITE_REG(USB_JTAG_BASE + USB_EP1_CONF, USB_EP1_WR_DONE);
 }
 
 // Bin 2 hex printer.
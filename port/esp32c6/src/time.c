@@ -3,6 +3,7 @@
 
 #include "time.h"
 
+#include "cpu/counters.h"
 #include "cpu/isr.h"
 #include "log.h"
 #include "port/hardware.h"
@@ -113,6 +114,33 @@
 
 
 
+// SYSTIMER configuration register (Access: R/W)
+#define SYSTIMER_CONF_REG           (SYSTIMER_BASE + 0x0000)
+// SYSTIMER unit 0 value update register (Access: varies)
+#define SYSTIMER_UNIT0_OP_REG       (SYSTIMER_BASE + 0x0004)
+// SYSTIMER unit 0 value, high 20 bits (Access: RO)
+#define SYSTIMER_UNIT0_VALUE_HI_REG (SYSTIMER_BASE + 0x0040)
+// SYSTIMER unit 0 value, low 32 bits (Access: RO)
+#define SYSTIMER_UNIT0_VALUE_LO_REG (SYSTIMER_BASE + 0x0044)
+// PCR SYSTIMER clock configuration register (Access: R/W)
+#define PCR_SYSTIMER_CONF_REG       (PCR_BASE + 0x0054)
+
+// SYSTIMER unit 0 counting enable.
+#define SYSTIMER_UNIT0_WORK_EN_BIT     0x40000000
+// Write to latch the SYSTIMER unit 0 value.
+#define SYSTIMER_UNIT0_UPDATE_BIT      0x40000000
+// SYSTIMER unit 0 latched value is valid.
+#define SYSTIMER_UNIT0_VALUE_VALID_BIT 0x20000000
+// PCR SYSTIMER clock enable.
+#define PCR_SYSTIMER_CLK_EN_BIT        0x00000001
+// PCR SYSTIMER reset.
+#define PCR_SYSTIMER_RST_EN_BIT        0x00000002
+
+// SYSTIMER ticks per microsecond; it counts at 16MHz from the 40MHz XTAL.
+#define SYSTIMER_TICKS_PER_US 16
+
+
+
 // Get timer group base address based on timer index.
 static inline size_t timg_base(int timerno) {
     return timerno ? TIMG1_BASE : TIMG0_BASE;
@@ -123,6 +151,40 @@ static inline size_t timg_base(int timerno) {
 
 
 
+#ifdef HAS_PROFILE
+// Number of calls per clock in `time_benchmark`.
+#define TIME_BENCHMARK_CALLS 64
+
+// Measure and log the per-call cost of each clock.
+static void time_benchmark() {
+    uint32_t start = cpu_cycles();
+    for (int i = 0; i < TIME_BENCHMARK_CALLS; i++) {
+        timer_value_get(TIMER_SYSTICK_NUM);
+    }
+    uint32_t timg = cpu_cycles() - start;
+
+    start = cpu_cycles();
+    for (int i = 0; i < TIME_BENCHMARK_CALLS; i++) {
+        time_us();
+    }
+    uint32_t systimer = cpu_cycles() - start;
+
+    start = cpu_cycles();
+    for (int i = 0; i < TIME_BENCHMARK_CALLS; i++) {
+        time_cycles();
+    }
+    uint32_t cycles = cpu_cycles() - start;
+
+    logkf(
+        LOG_INFO,
+        "Clock cost per call: TIMG %{u32;d}, SYSTIMER %{u32;d}, cycle counter %{u32;d} cycles",
+        timg / TIME_BENCHMARK_CALLS,
+        systimer / TIME_BENCHMARK_CALLS,
+        cycles / TIME_BENCHMARK_CALLS
+    );
+}
+#endif
+
 // Initialise timer and watchdog subsystem.
 void time_init() {
     // Disable LP WDT.
@@ -145,11 +207,31 @@ void time_init() {
 
     // Start systick timer.
     timer_start(TIMER_SYSTICK_NUM);
+
+    // Make sure SYSTIMER unit 0 counts; it is the clock for `time_us`.
+    uint32_t pcr_conf = READ_REG(PCR_SYSTIMER_CONF_REG);
+    WRITE_REG(PCR_SYSTIMER_CONF_REG, (pcr_conf | PCR_SYSTIMER_CLK_EN_BIT) & ~PCR_SYSTIMER_RST_EN_BIT);
+    WRITE_REG(SYSTIMER_CONF_REG, READ_REG(SYSTIMER_CONF_REG) | SYSTIMER_UNIT0_WORK_EN_BIT);
+
+#ifdef HAS_PROFILE
+    time_benchmark();
+#endif
 }
 
 // Get current time in microseconds.
+// SYSTIMER latches its value within a few cycles, where the TIMG value is only updated on the next timer tick.
 int64_t time_us() {
-    return timer_value_get(TIMER_SYSTICK_NUM);
+    WRITE_REG(SYSTIMER_UNIT0_OP_REG, SYSTIMER_UNIT0_UPDATE_BIT);
+    while (!(READ_REG(SYSTIMER_UNIT0_OP_REG) & SYSTIMER_UNIT0_VALUE_VALID_BIT)) continue;
+    uint32_t lo = READ_REG(SYSTIMER_UNIT0_VALUE_LO_REG);
+    uint32_t hi = READ_REG(SYSTIMER_UNIT0_VALUE_HI_REG);
+    return (lo | ((uint64_t)hi << 32)) / SYSTIMER_TICKS_PER_US;
+}
+
+// Get the CPU cycle counter.
+// It wraps around every 2^32 cycles, so it is only suitable for measuring short intervals.
+uint32_t time_cycles() {
+    return cpu_cycles();
 }
 
 // Set the counting frequency of a hardware timer.
@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: MIT
+
+#include "arena.h"
+
+#include "badge_strings.h"
+#include "log.h"
+
+// NOLINTBEGIN
+extern char __start_free_sram[];
+extern char __stop_free_sram[];
+// NOLINTEND
+
+
+
+// Bytes allocated from the start of the arena.
+static size_t arena_top;
+// Most bytes allocated at once.
+static size_t arena_peak;
+// Whether the arena was handed over to the kernel.
+static bool   arena_released;
+// Whether an allocation failed because the arena was full.
+static bool   arena_exhausted;
+
+// Allocate `size` bytes aligned to `align` (a power of two), or NULL if the arena is full or released.
+void *arena_alloc(size_t size, size_t align) {
+    if (arena_released) {
+        logk(LOG_ERROR, "Boot arena used after release");
+        return NULL;
+    }
+    size_t base  = (size_t)__start_free_sram;
+    size_t start = (base + arena_top + align - 1) & ~(align - 1);
+    if (start - base > arena_size() || size > arena_size() - (start - base)) {
+        arena_exhausted = true;
+        logkf(LOG_ERROR, "Boot arena full; %{size;d} bytes requested", size);
+        return NULL;
+    }
+    arena_top = start - base + size;
+    if (arena_top > arena_peak) {
+        arena_peak = arena_top;
+    }
+    return (void *)start;
+}
+
+// Allocate `size` zeroed bytes aligned to `align` (a power of two), or NULL if the arena is full or released.
+void *arena_calloc(size_t size, size_t align) {
+    void *mem = arena_alloc(size, align);
+    if (mem) {
+        mem_set(mem, 0, size);
+    }
+    return mem;
+}
+
+// Get the current position in the arena.
+arena_mark_t arena_mark() {
+    return arena_top;
+}
+
+// Free everything allocated after `mark`.
+void arena_restore(arena_mark_t const *mark) {
+    if (*mark < arena_top) {
+        arena_top = *mark;
+    }
+}
+
+// Number of bytes currently allocated.
+size_t arena_used() {
+    return arena_top;
+}
+
+// Most bytes allocated at once.
+size_t arena_high_water() {
+    return arena_peak;
+}
+
+// Total size of the arena.
+size_t arena_size() {
+    return __stop_free_sram - __start_free_sram;
+}
+
+// Print the arena usage.
+void arena_stats() {
+    logkf(
+        arena_exhausted ? LOG_WARN : LOG_DEBUG,
+        "Boot arena: %{size;d} of %{size;d} bytes used at most",
+        arena_peak,
+        arena_size()
+    );
+}
+
+// Free the entire arena for good before the kernel overwrites it; later allocations fail.
+void arena_release() {
+    arena_top      = 0;
+    arena_released = true;
+}
@@ -3,7 +3,6 @@
 
 #include "arrays.h"
 
-#include "assertions.h"
 #include "badge_strings.h"
 
 
@@ -18,11 +17,6 @@ static inline void const *array_index_const(void const *array, size_t ent_size,
     return (void *)((size_t)array + ent_size * index);
 }
 
-// Swap two elements.
-static inline void array_swap(void *array, size_t ent_size, size_t a, size_t b) {
-    mem_swap(array_index(array, ent_size, a), array_index(array, ent_size, b), ent_size);
-}
-
 
 
 // Binary search for a value in a sorted (ascending order) array.
@@ -54,71 +48,87 @@ array_binsearch_t array_binsearch(
 
 
 
-// A recursive array sorting implementation.
-void array_sort_impl(void *array, void *tmp, size_t ent_size, size_t ent_count, array_sort_comp_t comparator) {
-    if (ent_count < 2) {
-        // Limit case: 1 entry; no sorting needed.
-        return;
-    } else if (ent_count == 2) {
-        // Limit case: 2 entries; single compare.
-        if (comparator(array, (void const *)((size_t)array + ent_size)) > 0) {
-            // Swap the entries.
-            array_swap(array, ent_size, 0, 1);
+// Largest part of an entry moved at once when shifting entries; larger entries are moved in several steps.
+#define ARRAY_ROTATE_CHUNK 32
+
+// Move the last entry of an array to the front, shifting the others up by one.
+static void array_rotate_right(void *array, size_t ent_size, size_t ent_count) {
+    uint8_t  buf[ARRAY_ROTATE_CHUNK];
+    uint8_t *ptr = array;
+    size_t   len = ent_size * ent_count;
+    for (size_t off = 0; off < ent_size; off += ARRAY_ROTATE_CHUNK) {
+        size_t chunk = ent_size - off < ARRAY_ROTATE_CHUNK ? ent_size - off : ARRAY_ROTATE_CHUNK;
+        mem_copy(buf, ptr + len - chunk, chunk);
+        mem_copy(ptr + chunk, ptr, len - chunk);
+        mem_copy(ptr, buf, chunk);
+    }
+}
+
+// Find the first entry of a sorted array that compares greater than `value`.
+static size_t array_upper_bound(
+    void const *array, size_t ent_size, size_t ent_count, void const *value, array_sort_comp_t comparator
+) {
+    size_t lo = 0;
+    size_t hi = ent_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (comparator(value, array_index_const(array, ent_size, mid)) < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+// Sort a contiguous array in place given a comparator function; meant for small arrays.
+// The array is sorted into ascending order; entries that compare equal keep their order.
+void array_sort(void *array, size_t ent_size, size_t ent_count, array_sort_comp_t comparator) {
+    for (size_t i = 1; i < ent_count; i++) {
+        void const *ent = array_index_const(array, ent_size, i);
+        if (comparator(array_index_const(array, ent_size, i - 1), ent) <= 0) {
+            // Already in order; the common case for nearly sorted arrays.
+            continue;
         }
+        size_t pos = array_upper_bound(array, ent_size, i - 1, ent, comparator);
+        array_rotate_right(array_index(array, ent_size, pos), ent_size, i - pos + 1);
+    }
+}
+
+// Sort a contiguous array given a comparator function, using `tmp` of at least `ent_count / 2` entries.
+// The array is sorted into ascending order; entries that compare equal keep their order.
+void array_sort_buf(void *array, void *tmp, size_t ent_size, size_t ent_count, array_sort_comp_t comparator) {
+    if (ent_count <= ARRAY_SORT_RUN) {
+        array_sort(array, ent_size, ent_count, comparator);
         return;
     }
 
     // Split array and sort recursively.
-    array_sort_impl(array, tmp, ent_size, ent_count / 2, comparator);
-    array_sort_impl(array_index(array, ent_size, ent_count / 2), tmp, ent_size, ent_count - ent_count / 2, comparator);
-
-    // Merge the sorted subarrays.
     size_t avl_a = ent_count / 2;
-    size_t avl_b = ent_count - ent_count / 2;
-    size_t i = 0, a = 0, b = 0;
+    size_t avl_b = ent_count - avl_a;
+    void  *arr_b = array_index(array, ent_size, avl_a);
+    array_sort_buf(array, tmp, ent_size, avl_a, comparator);
+    array_sort_buf(arr_b, tmp, ent_size, avl_b, comparator);
+    if (comparator(array_index_const(array, ent_size, avl_a - 1), arr_b) <= 0) {
+        // The halves are already in order.
+        return;
+    }
 
-    // Continually select the lower value from either array.
+    // Continually select the lower value from the first half, moved to `tmp`, or the second half.
+    mem_copy(tmp, array, ent_size * avl_a);
+    size_t i = 0, a = 0, b = 0;
     for (; a < avl_a && b < avl_b; i++) {
-        void *a_ptr = array_index(array, ent_size, a);
-        void *b_ptr = array_index(array, ent_size, avl_a + b);
+        void const *a_ptr = array_index_const(tmp, ent_size, a);
+        void const *b_ptr = array_index_const(arr_b, ent_size, b);
         if (comparator(a_ptr, b_ptr) > 0) {
-            mem_copy(array_index(tmp, ent_size, i), b_ptr, ent_size);
+            mem_copy(array_index(array, ent_size, i), b_ptr, ent_size);
             b++;
         } else {
-            mem_copy(array_index(tmp, ent_size, i), a_ptr, ent_size);
+            mem_copy(array_index(array, ent_size, i), a_ptr, ent_size);
             a++;
         }
     }
 
-    // Add any remainder.
-    for (; a < avl_a; a++, i++) {
-        void *a_ptr = array_index(array, ent_size, a);
-        mem_copy(array_index(tmp, ent_size, i), a_ptr, ent_size);
-    }
-    for (; b < avl_b; b++, i++) {
-        void *b_ptr = array_index(array, ent_size, avl_a + b);
-        mem_copy(array_index(tmp, ent_size, i), b_ptr, ent_size);
-    }
-
-    // Copy it all back into the output.
-    mem_copy(array, tmp, ent_size * ent_count);
+    // Add any remainder of the first half; that of the second half is already in place.
+    mem_copy(array_index(array, ent_size, i), array_index_const(tmp, ent_size, a), ent_size * (avl_a - a));
 }
-
-// Sort a contiguous array given a comparator function.
-// The array is sorted into ascending order.
-/* void array_sort(void *array, size_t ent_size, size_t ent_count, array_sort_comp_t comparator) {
-    if (ent_count <= 1) {
-        // Edge case: 0 or 1 entries; no sorting needed.
-    } else if (ent_count == 2) {
-        // Edge case: 2 entries; single compare.
-        if (comparator(array, (void const *)((size_t)array + ent_size)) > 0) {
-            array_swap(array, ent_size, 0, 1);
-        }
-    } else {
-        // 3 or more entries: sorting needed.
-        void *mem = malloc(ent_size * ent_count);
-        assert_always(mem != NULL);
-        array_sort_impl(array, mem, ent_size, ent_count, comparator);
-        free(mem);
-    }
-} */
@@ -1,8 +1,18 @@
 
 // SPDX-License-Identifier: MIT
 
+// GCC must not turn the loops in here into calls to `memcpy` or `memset`, which are implemented with them.
+#pragma GCC optimize("no-tree-loop-distribute-patterns")
+
 #include <badge_strings.h>
 
+#ifdef HAS_PROFILE
+// The profiler is part of the bootloader, not of badgelib; only pull it in when it is enabled.
+#include "profile.h"
+#else
+#define PROFILE_SCOPE(id) (void)0
+#endif
+
 
 
 // Compute the length of a C-string.
@@ -230,39 +240,68 @@ bool mem_equals(void const *a, void const *b, size_t size) {
 
 
 
-// Implementation of the mem_copy loop with variable access size.
-#define MEM_COPY_IMPL(type, alignment, dest, src, size)                                                                \
-    {                                                                                                                  \
-        type       *dest_ptr = (dest); /* NOLINT*/                                                                     \
-        type const *src_ptr  = (src);  /* NOLINT*/                                                                     \
-        size_t      _size    = (size) / (alignment);                                                                   \
-        if ((dest) < (src)) {                                                                                          \
-            /* Forward iteration. */                                                                                   \
-            for (size_t i = 0; i < _size; i++) {                                                                       \
-                dest_ptr[i] = src_ptr[i];                                                                              \
-            }                                                                                                          \
-        } else if ((src) < (dest)) {                                                                                   \
-            /* Reverse iteration. */                                                                                   \
-            for (size_t i = _size; i-- > 0;) {                                                                         \
-                dest_ptr[i] = src_ptr[i];                                                                              \
-            }                                                                                                          \
-        }                                                                                                              \
+// Word used for bulk copies; may alias any type.
+typedef size_t __attribute__((may_alias)) mem_word_t;
+// Mask of the address bits within a word.
+#define MEM_WORD_MASK (sizeof(mem_word_t) - 1)
+
+// Copy forward, one word at a time where `dest` and `src` are equally aligned.
+static inline void mem_copy_forward(uint8_t *dest, uint8_t const *src, size_t size) {
+    if (!(((size_t)dest ^ (size_t)src) & MEM_WORD_MASK)) {
+        for (; size && ((size_t)dest & MEM_WORD_MASK); size--) {
+            *dest++ = *src++;
+        }
+        mem_word_t       *dest_word = (mem_word_t *)dest;
+        mem_word_t const *src_word  = (mem_word_t const *)src;
+        for (; size >= 4 * sizeof(mem_word_t); size -= 4 * sizeof(mem_word_t)) {
+            dest_word[0]  = src_word[0];
+            dest_word[1]  = src_word[1];
+            dest_word[2]  = src_word[2];
+            dest_word[3]  = src_word[3];
+            dest_word    += 4;
+            src_word     += 4;
+        }
+        for (; size >= sizeof(mem_word_t); size -= sizeof(mem_word_t)) {
+            *dest_word++ = *src_word++;
+        }
+        dest = (uint8_t *)dest_word;
+        src  = (uint8_t const *)src_word;
+    }
+    for (; size; size--) {
+        *dest++ = *src++;
+    }
+}
+
+// Copy backward, one word at a time where `dest` and `src` are equally aligned.
+// `dest` and `src` point to the end of the memory areas.
+static inline void mem_copy_backward(uint8_t *dest, uint8_t const *src, size_t size) {
+    if (!(((size_t)dest ^ (size_t)src) & MEM_WORD_MASK)) {
+        for (; size && ((size_t)dest & MEM_WORD_MASK); size--) {
+            *--dest = *--src;
+        }
+        mem_word_t       *dest_word = (mem_word_t *)dest;
+        mem_word_t const *src_word  = (mem_word_t const *)src;
+        for (; size >= sizeof(mem_word_t); size -= sizeof(mem_word_t)) {
+            *--dest_word = *--src_word;
+        }
+        dest = (uint8_t *)dest_word;
+        src  = (uint8_t const *)src_word;
     }
+    for (; size; size--) {
+        *--dest = *--src;
+    }
+}
 
 // Copy the contents of memory area `src` to memory area `dest`.
 // Correct copying is gauranteed even if `src` and `dest` are overlapping regions.
 void mem_copy(void *dest, void const *src, size_t size) {
-    size_t align_detector = (size_t)dest | (size_t)src | (size_t)size;
-
-    // Optimise for alignment.
-    if (align_detector & 1) {
-        MEM_COPY_IMPL(uint8_t, 1, dest, src, size)
-    } else if (align_detector & 2) {
-        MEM_COPY_IMPL(uint16_t, 2, dest, src, size)
-    } else if (align_detector & 4) {
-        MEM_COPY_IMPL(uint32_t, 4, dest, src, size)
-    } else {
-        MEM_COPY_IMPL(uint64_t, 8, dest, src, size)
+    PROFILE_SCOPE(mem_copy);
+    uint8_t       *dest_ptr = dest;
+    uint8_t const *src_ptr  = src;
+    if (dest_ptr < src_ptr) {
+        mem_copy_forward(dest_ptr, src_ptr, size);
+    } else if (src_ptr < dest_ptr) {
+        mem_copy_backward(dest_ptr + size, src_ptr + size, size);
     }
 }
 
@@ -299,29 +338,28 @@ void mem_swap(void *a, void *b, size_t size) {
     }
 }
 
-// Implementation of the mem_set loop with variable access size.
-#define MEM_SET_IMPL(type, alignment, dest, value, size)                                                               \
-    {                                                                                                                  \
-        type  *dest_ptr = (dest); /* NOLINT */                                                                         \
-        size_t _size    = (size) / (alignment);                                                                        \
-        for (size_t i = 0; i < _size; i++) {                                                                           \
-            dest_ptr[i] = (value);                                                                                     \
-        }                                                                                                              \
-    }
-
 // Set the contents of memory area `dest` to the constant byte `value`.
 void mem_set(void *dest, uint8_t value, size_t size) {
-    size_t align_detector = (size_t)dest | (size_t)size;
-
-    // Optimise for alignment.
-    if (align_detector & 1) {
-        MEM_SET_IMPL(uint8_t, 1, dest, value, size)
-    } else if (align_detector & 2) {
-        MEM_SET_IMPL(uint16_t, 2, dest, value, size)
-    } else if (align_detector & 4) {
-        MEM_SET_IMPL(uint32_t, 4, dest, value, size)
-    } else {
-        MEM_SET_IMPL(uint64_t, 8, dest, value, size)
+    uint8_t *dest_ptr = dest;
+    for (; size && ((size_t)dest_ptr & MEM_WORD_MASK); size--) {
+        *dest_ptr++ = value;
+    }
+    // Every byte of the word holds `value`.
+    mem_word_t  word      = value * (SIZE_MAX / 0xff);
+    mem_word_t *dest_word = (mem_word_t *)dest_ptr;
+    for (; size >= 4 * sizeof(mem_word_t); size -= 4 * sizeof(mem_word_t)) {
+        dest_word[0]  = word;
+        dest_word[1]  = word;
+        dest_word[2]  = word;
+        dest_word[3]  = word;
+        dest_word    += 4;
+    }
+    for (; size >= sizeof(mem_word_t); size -= sizeof(mem_word_t)) {
+        *dest_word++ = word;
+    }
+    dest_ptr = (uint8_t *)dest_word;
+    for (; size; size--) {
+        *dest_ptr++ = value;
     }
 }
 
@@ -347,7 +385,12 @@ void *memmove(void *dst, void const *src, size_t len) {
 
 // Function call emitted by the compiler.
 int memcmp(void const *a, void const *b, size_t len) {
-    // This is not strictly correct according to the `memcmp` spec,
-    // but it will work for equality tests.
-    return !mem_equals(a, b, len);
+    uint8_t const *a_ptr = a;
+    uint8_t const *b_ptr = b;
+    for (size_t i = 0; i < len; i++) {
+        if (a_ptr[i] != b_ptr[i]) {
+            return a_ptr[i] - b_ptr[i];
+        }
+    }
+    return 0;
 }
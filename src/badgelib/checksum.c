@@ -96,3 +96,242 @@ crc32_t _crc32_update(crc32_t crc, void const *mem, size_t len) {
     }
     return crc;
 }
+
+
+
+// SHA-256 round constants.
+static uint32_t const sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+// SHA-512 round constants.
+static uint64_t const sha512_k[80] = {
+    0x428a2f98d728ae22, 0x7137449123ef65cd, 0xb5c0fbcfec4d3b2f, 0xe9b5dba58189dbbc, 0x3956c25bf348b538,
+    0x59f111f1b605d019, 0x923f82a4af194f9b, 0xab1c5ed5da6d8118, 0xd807aa98a3030242, 0x12835b0145706fbe,
+    0x243185be4ee4b28c, 0x550c7dc3d5ffb4e2, 0x72be5d74f27b896f, 0x80deb1fe3b1696b1, 0x9bdc06a725c71235,
+    0xc19bf174cf692694, 0xe49b69c19ef14ad2, 0xefbe4786384f25e3, 0x0fc19dc68b8cd5b5, 0x240ca1cc77ac9c65,
+    0x2de92c6f592b0275, 0x4a7484aa6ea6e483, 0x5cb0a9dcbd41fbd4, 0x76f988da831153b5, 0x983e5152ee66dfab,
+    0xa831c66d2db43210, 0xb00327c898fb213f, 0xbf597fc7beef0ee4, 0xc6e00bf33da88fc2, 0xd5a79147930aa725,
+    0x06ca6351e003826f, 0x142929670a0e6e70, 0x27b70a8546d22ffc, 0x2e1b21385c26c926, 0x4d2c6dfc5ac42aed,
+    0x53380d139d95b3df, 0x650a73548baf63de, 0x766a0abb3c77b2a8, 0x81c2c92e47edaee6, 0x92722c851482353b,
+    0xa2bfe8a14cf10364, 0xa81a664bbc423001, 0xc24b8b70d0f89791, 0xc76c51a30654be30, 0xd192e819d6ef5218,
+    0xd69906245565a910, 0xf40e35855771202a, 0x106aa07032bbd1b8, 0x19a4c116b8d2d0c8, 0x1e376c085141ab53,
+    0x2748774cdf8eeb99, 0x34b0bcb5e19b48a8, 0x391c0cb3c5c95a63, 0x4ed8aa4ae3418acb, 0x5b9cca4f7763e373,
+    0x682e6ff3d6b2b8a3, 0x748f82ee5defb2fc, 0x78a5636f43172f60, 0x84c87814a1f0ab72, 0x8cc702081a6439ec,
+    0x90befffa23631e28, 0xa4506cebde82bde9, 0xbef9a3f7b2c67915, 0xc67178f2e372532b, 0xca273eceea26619c,
+    0xd186b8c721c0c207, 0xeada7dd6cde0eb1e, 0xf57d4f7fee6ed178, 0x06f067aa72176fba, 0x0a637dc5a2c898a6,
+    0x113f9804bef90dae, 0x1b710b35131c471b, 0x28db77f523047d84, 0x32caab7b40c72493, 0x3c9ebe0a15c9bebc,
+    0x431d67c49c100d4c, 0x4cc5d4becb3e42b6, 0x597f299cfc657e2a, 0x5fcb6fab3ad6faec, 0x6c44198c4a475817,
+};
+
+// Process one 64-byte SHA-256 block.
+static void sha256_block(uint32_t state[8], uint8_t const *block) {
+    uint32_t w[16];
+    uint32_t v[8];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)block[4 * i] << 24) | (block[4 * i + 1] << 16) | (block[4 * i + 2] << 8) | block[4 * i + 3];
+    }
+    for (int i = 0; i < 8; i++) {
+        v[i] = state[i];
+    }
+
+    // The message schedule is kept in a 16-word ring.
+    for (int i = 0; i < 64; i++) {
+        if (i >= 16) {
+            uint32_t w15  = w[(i - 15) & 15];
+            uint32_t w2   = w[(i - 2) & 15];
+            uint32_t s0   = roru32(w15, 7) ^ roru32(w15, 18) ^ (w15 >> 3);
+            uint32_t s1   = roru32(w2, 17) ^ roru32(w2, 19) ^ (w2 >> 10);
+            w[i & 15]    += s0 + w[(i - 7) & 15] + s1;
+        }
+        uint32_t s1  = roru32(v[4], 6) ^ roru32(v[4], 11) ^ roru32(v[4], 25);
+        uint32_t ch  = (v[4] & v[5]) ^ (~v[4] & v[6]);
+        uint32_t t1  = v[7] + s1 + ch + sha256_k[i] + w[i & 15];
+        uint32_t s0  = roru32(v[0], 2) ^ roru32(v[0], 13) ^ roru32(v[0], 22);
+        uint32_t maj = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+        v[7]         = v[6];
+        v[6]         = v[5];
+        v[5]         = v[4];
+        v[4]         = v[3] + t1;
+        v[3]         = v[2];
+        v[2]         = v[1];
+        v[1]         = v[0];
+        v[0]         = t1 + s0 + maj;
+    }
+
+    for (int i = 0; i < 8; i++) {
+        state[i] += v[i];
+    }
+}
+
+// Hash whole 64-byte blocks into a SHA-256 intermediate hash value.
+void sha256_blocks(uint32_t state[8], void const *mem, size_t count) {
+    uint8_t const *ptr = mem;
+    for (; count; ptr += 64, count--) {
+        sha256_block(state, ptr);
+    }
+}
+
+// Initialize a SHA-256 hash.
+void sha256_init(sha256_t *ctx) {
+    static uint32_t const init[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    mem_copy(ctx->state, init, sizeof(init));
+    ctx->length = 0;
+}
+
+// Add data to a SHA-256 hash.
+void sha256_update(sha256_t *ctx, void const *mem, size_t len) {
+    uint8_t const *ptr  = mem;
+    size_t         fill = ctx->length % 64;
+    ctx->length        += len;
+
+    // Complete a partial block first.
+    if (fill) {
+        size_t cap = 64 - fill < len ? 64 - fill : len;
+        mem_copy(ctx->block + fill, ptr, cap);
+        ptr += cap;
+        len -= cap;
+        if (fill + cap < 64) {
+            return;
+        }
+        sha256_block(ctx->state, ctx->block);
+    }
+
+    // Whole blocks are hashed in place.
+    for (; len >= 64; ptr += 64, len -= 64) {
+        sha256_block(ctx->state, ptr);
+    }
+    mem_copy(ctx->block, ptr, len);
+}
+
+// Finalize a SHA-256 hash and write the digest.
+void sha256_final(sha256_t *ctx, uint8_t digest[SHA256_DIGEST_LEN]) {
+    uint64_t bits = ctx->length * 8;
+    size_t   fill = ctx->length % 64;
+
+    ctx->block[fill++] = 0x80;
+    if (fill > 56) {
+        mem_set(ctx->block + fill, 0, 64 - fill);
+        sha256_block(ctx->state, ctx->block);
+        fill = 0;
+    }
+    mem_set(ctx->block + fill, 0, 56 - fill);
+    for (int i = 0; i < 8; i++) {
+        ctx->block[56 + i] = bits >> (56 - 8 * i);
+    }
+    sha256_block(ctx->state, ctx->block);
+
+    for (int i = 0; i < 32; i++) {
+        digest[i] = ctx->state[i / 4] >> (24 - 8 * (i % 4));
+    }
+}
+
+// Process one 128-byte SHA-512 block.
+static void sha512_block(uint64_t state[8], uint8_t const *block) {
+    uint64_t w[16];
+    uint64_t v[8];
+    for (int i = 0; i < 16; i++) {
+        w[i] = 0;
+        for (int j = 0; j < 8; j++) {
+            w[i] = (w[i] << 8) | block[8 * i + j];
+        }
+    }
+    for (int i = 0; i < 8; i++) {
+        v[i] = state[i];
+    }
+
+    // The message schedule is kept in a 16-word ring.
+    for (int i = 0; i < 80; i++) {
+        if (i >= 16) {
+            uint64_t w15  = w[(i - 15) & 15];
+            uint64_t w2   = w[(i - 2) & 15];
+            uint64_t s0   = roru64(w15, 1) ^ roru64(w15, 8) ^ (w15 >> 7);
+            uint64_t s1   = roru64(w2, 19) ^ roru64(w2, 61) ^ (w2 >> 6);
+            w[i & 15]    += s0 + w[(i - 7) & 15] + s1;
+        }
+        uint64_t s1  = roru64(v[4], 14) ^ roru64(v[4], 18) ^ roru64(v[4], 41);
+        uint64_t ch  = (v[4] & v[5]) ^ (~v[4] & v[6]);
+        uint64_t t1  = v[7] + s1 + ch + sha512_k[i] + w[i & 15];
+        uint64_t s0  = roru64(v[0], 28) ^ roru64(v[0], 34) ^ roru64(v[0], 39);
+        uint64_t maj = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+        v[7]         = v[6];
+        v[6]         = v[5];
+        v[5]         = v[4];
+        v[4]         = v[3] + t1;
+        v[3]         = v[2];
+        v[2]         = v[1];
+        v[1]         = v[0];
+        v[0]         = t1 + s0 + maj;
+    }
+
+    for (int i = 0; i < 8; i++) {
+        state[i] += v[i];
+    }
+}
+
+// Initialize a SHA-512 hash.
+void sha512_init(sha512_t *ctx) {
+    static uint64_t const init[8] = {
+        0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+        0x510e527fade682d1, 0x9b05688c2b3e6c1f, 0x1f83d9abfb41bd6b, 0x5be0cd19137e2179,
+    };
+    mem_copy(ctx->state, init, sizeof(init));
+    ctx->length = 0;
+}
+
+// Add data to a SHA-512 hash.
+void sha512_update(sha512_t *ctx, void const *mem, size_t len) {
+    uint8_t const *ptr  = mem;
+    size_t         fill = ctx->length % 128;
+    ctx->length        += len;
+
+    // Complete a partial block first.
+    if (fill) {
+        size_t cap = 128 - fill < len ? 128 - fill : len;
+        mem_copy(ctx->block + fill, ptr, cap);
+        ptr += cap;
+        len -= cap;
+        if (fill + cap < 128) {
+            return;
+        }
+        sha512_block(ctx->state, ctx->block);
+    }
+
+    // Whole blocks are hashed in place.
+    for (; len >= 128; ptr += 128, len -= 128) {
+        sha512_block(ctx->state, ptr);
+    }
+    mem_copy(ctx->block, ptr, len);
+}
+
+// Finalize a SHA-512 hash and write the digest.
+void sha512_final(sha512_t *ctx, uint8_t digest[SHA512_DIGEST_LEN]) {
+    uint64_t bits = ctx->length * 8;
+    size_t   fill = ctx->length % 128;
+
+    ctx->block[fill++] = 0x80;
+    if (fill > 112) {
+        mem_set(ctx->block + fill, 0, 128 - fill);
+        sha512_block(ctx->state, ctx->block);
+        fill = 0;
+    }
+    // The upper 64 bits of the 128-bit length are always zero.
+    mem_set(ctx->block + fill, 0, 120 - fill);
+    for (int i = 0; i < 8; i++) {
+        ctx->block[120 + i] = bits >> (56 - 8 * i);
+    }
+    sha512_block(ctx->state, ctx->block);
+
+    for (int i = 0; i < 64; i++) {
+        digest[i] = ctx->state[i / 8] >> (56 - 8 * (i % 8));
+    }
+}
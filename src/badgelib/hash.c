@@ -0,0 +1,117 @@
+// SPDX-License-Identifier: MIT
+
+#include "hash.h"
+
+#include "badge_strings.h"
+
+
+
+// Registered hash engines.
+static hash_engine_t *engines = NULL;
+
+// Software engine: start a new hash.
+static bool hash_sw_claim(hash_t *ctx) {
+    sha256_init(&ctx->sw);
+    return true;
+}
+
+// Software engine: hash whole blocks.
+static void hash_sw_blocks(hash_t *ctx, void const *mem, size_t count) {
+    sha256_blocks(ctx->sw.state, mem, count);
+}
+
+// Software engine: write the intermediate hash value.
+static void hash_sw_finish(hash_t *ctx, uint8_t digest[SHA256_DIGEST_LEN]) {
+    for (int i = 0; i < SHA256_DIGEST_LEN; i++) {
+        digest[i] = ctx->sw.state[i / 4] >> (24 - 8 * (i % 4));
+    }
+}
+
+// Software hash engine; always available.
+hash_engine_t const hash_engine_sw = {
+    .name   = "software",
+    .claim  = hash_sw_claim,
+    .blocks = hash_sw_blocks,
+    .finish = hash_sw_finish,
+};
+
+
+
+// Register a new hash engine, preferred over the software engine.
+// This should only be called from constructor functions.
+void hash_engine_register(hash_engine_t *engine) {
+    engine->next = engines;
+    engines      = engine;
+}
+
+// Start a new hash on a specific engine.
+bool hash_init_engine(hash_t *ctx, hash_engine_t const *engine) {
+    if (!engine->claim(ctx)) {
+        return false;
+    }
+    ctx->engine    = engine;
+    ctx->sw.length = 0;
+    return true;
+}
+
+// Start a new hash on the first registered engine that is available, or in software.
+void hash_init(hash_t *ctx) {
+    for (hash_engine_t *engine = engines; engine; engine = engine->next) {
+        if (hash_init_engine(ctx, engine)) {
+            return;
+        }
+    }
+    hash_init_engine(ctx, &hash_engine_sw);
+}
+
+// Add data to a hash.
+void hash_update(hash_t *ctx, void const *mem, size_t len) {
+    uint8_t const *ptr  = mem;
+    size_t         fill = ctx->sw.length % 64;
+    ctx->sw.length     += len;
+
+    // Complete a partial block first.
+    if (fill) {
+        size_t cap = 64 - fill < len ? 64 - fill : len;
+        mem_copy(ctx->sw.block + fill, ptr, cap);
+        ptr += cap;
+        len -= cap;
+        if (fill + cap < 64) {
+            return;
+        }
+        ctx->engine->blocks(ctx, ctx->sw.block, 1);
+    }
+
+    // Whole blocks are fed to the engine straight from the caller's buffer.
+    if (len >= 64) {
+        ctx->engine->blocks(ctx, ptr, len / 64);
+        ptr += len & ~(size_t)63;
+        len &= 63;
+    }
+    mem_copy(ctx->sw.block, ptr, len);
+}
+
+// Finalize a hash and write the digest.
+void hash_final(hash_t *ctx, uint8_t digest[SHA256_DIGEST_LEN]) {
+    uint64_t bits = ctx->sw.length * 8;
+    size_t   fill = ctx->sw.length % 64;
+
+    ctx->sw.block[fill++] = 0x80;
+    if (fill > 56) {
+        mem_set(ctx->sw.block + fill, 0, 64 - fill);
+        ctx->engine->blocks(ctx, ctx->sw.block, 1);
+        fill = 0;
+    }
+    mem_set(ctx->sw.block + fill, 0, 56 - fill);
+    for (int i = 0; i < 8; i++) {
+        ctx->sw.block[56 + i] = bits >> (56 - 8 * i);
+    }
+    ctx->engine->blocks(ctx, ctx->sw.block, 1);
+    ctx->engine->finish(ctx, digest);
+}
+
+// Abandon a hash and release its engine.
+void hash_abort(hash_t *ctx) {
+    uint8_t digest[SHA256_DIGEST_LEN];
+    ctx->engine->finish(ctx, digest);
+}
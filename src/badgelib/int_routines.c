@@ -1,7 +1,8 @@
 
 // SPDX-License-Identifier: MIT
 
-// This file contains definitions for all GCC routines for integer arithmetic with the exception of int bit shifts.
+// This file contains definitions for all GCC routines for integer arithmetic with the exception of int bit shifts,
+// and for the bit counting and byte swapping routines.
 
 #pragma GCC optimize("O2")
 
@@ -27,7 +28,7 @@ typedef unsigned int uti_t __attribute__((mode(TI)));
         u##type result;                                                                                                \
     } divmod_##name##_t;                                                                                               \
     static divmod_##name##_t divmod_##name(u##type remainder, u##type divisor) {                                       \
-        u##type const msb    = 1ull << (sizeof(type) * 8 - 1);                                                         \
+        u##type const msb    = (u##type)1 << (sizeof(type) * 8 - 1);                                                   \
         u##type       result = 0;                                                                                      \
         unsigned int  shift  = 0;                                                                                      \
         while (!(divisor & msb)) {                                                                                     \
@@ -36,7 +37,7 @@ typedef unsigned int uti_t __attribute__((mode(TI)));
         }                                                                                                              \
         for (unsigned int i = 0; i <= shift; i++) {                                                                    \
             if (remainder >= divisor) {                                                                                \
-                result    |= 1ull << (shift - i);                                                                      \
+                result    |= (u##type)1 << (shift - i);                                                                \
                 remainder -= divisor;                                                                                  \
             }                                                                                                          \
             divisor >>= 1;                                                                                             \
@@ -46,11 +47,132 @@ typedef unsigned int uti_t __attribute__((mode(TI)));
 
 // Division implementations.
 DIVMOD_IMPL(si_t, si)
-DIVMOD_IMPL(di_t, di)
 #ifdef do_ti_math
 DIVMOD_IMPL(ti_t, ti)
 #endif
 
+// Result of 64-bit division.
+typedef struct {
+    udi_t remainder;
+    udi_t result;
+} divmod_di_t;
+
+// Number of leading zero bits in a nonzero 32-bit value.
+static inline int clz_si(usi_t value) {
+    int count = 0;
+    for (int shift = 16; shift; shift /= 2) {
+        if (!(value >> (32 - shift))) {
+            value <<= shift;
+            count  += shift;
+        }
+    }
+    return count;
+}
+
+// Upper 64 bits of the 128-bit product of `a` and `b`, from 32-bit multiplications.
+static inline udi_t mulhi_di(udi_t a, udi_t b) {
+    udi_t lo_lo = (udi_t)(usi_t)a * (usi_t)b;
+    udi_t hi_lo = (udi_t)(usi_t)(a >> 32) * (usi_t)b;
+    udi_t lo_hi = (udi_t)(usi_t)a * (usi_t)(b >> 32);
+    udi_t hi_hi = (udi_t)(usi_t)(a >> 32) * (usi_t)(b >> 32);
+    udi_t cross = (lo_lo >> 32) + (usi_t)hi_lo + lo_hi;
+    return hi_hi + (hi_lo >> 32) + (cross >> 32);
+}
+
+// Divide `hi:lo` by `divisor` where `hi < divisor`, so the quotient fits in 32 bits.
+// Long division in base 2^16 with a normalized divisor, using the 32-bit hardware divider (Hacker's Delight `divlu`).
+static usi_t divlu_si(usi_t hi, usi_t lo, usi_t divisor, usi_t *rem) {
+    int shift   = clz_si(divisor);
+    divisor   <<= shift;
+    usi_t div1  = divisor >> 16;
+    usi_t div0  = divisor & 0xffff;
+    usi_t num32 = shift ? (hi << shift) | (lo >> (32 - shift)) : hi;
+    usi_t num10 = lo << shift;
+    usi_t num1  = num10 >> 16;
+    usi_t num0  = num10 & 0xffff;
+
+    // First quotient digit; the estimate is at most 2 too high.
+    usi_t q1   = num32 / div1;
+    usi_t rhat = num32 - q1 * div1;
+    while ((q1 >> 16) || q1 * div0 > ((rhat << 16) | num1)) {
+        q1--;
+        rhat += div1;
+        if (rhat >> 16) {
+            break;
+        }
+    }
+
+    // Second quotient digit.
+    usi_t num21 = (num32 << 16) + num1 - q1 * divisor;
+    usi_t q0    = num21 / div1;
+    rhat        = num21 - q0 * div1;
+    while ((q0 >> 16) || q0 * div0 > ((rhat << 16) | num0)) {
+        q0--;
+        rhat += div1;
+        if (rhat >> 16) {
+            break;
+        }
+    }
+
+    *rem = ((num21 << 16) + num0 - q0 * divisor) >> shift;
+    return (q1 << 16) | q0;
+}
+
+// Divide by a constant using multiplication by its reciprocal; `magic`, `pre` and `post` are from
+// Granlund-Montgomery and exact for all 64-bit dividends.
+static inline divmod_di_t divmod_di_const(udi_t remainder, udi_t divisor, udi_t magic, int pre, int post) {
+    udi_t result = mulhi_di(remainder >> pre, magic) >> post;
+    return (divmod_di_t){remainder - result * divisor, result};
+}
+
+// Unsigned 64-bit division.
+// Does not do any edge case checks; divisor must never be 0.
+static divmod_di_t divmod_di(udi_t remainder, udi_t divisor) {
+    usi_t num_hi = remainder >> 32;
+    usi_t num_lo = remainder;
+    usi_t div_hi = divisor >> 32;
+    usi_t div_lo = divisor;
+
+    if (!div_hi) {
+        if (!num_hi) {
+            // Both fit in 32 bits.
+            return (divmod_di_t){num_lo % div_lo, num_lo / div_lo};
+        }
+
+        // Common constant divisors: microseconds to milliseconds and seconds, decimal digits.
+        if (div_lo == 1000) {
+            return divmod_di_const(remainder, divisor, 0x20c49ba5e353f7cf, 3, 4);
+        } else if (div_lo == 1000000) {
+            return divmod_di_const(remainder, divisor, 0x431bde82d7b634db, 0, 18);
+        } else if (div_lo == 10) {
+            return divmod_di_const(remainder, divisor, 0xcccccccccccccccd, 0, 3);
+        }
+
+        // 64-by-32-bit: the high word first, then the remainder with the low word.
+        usi_t rem;
+        usi_t q_hi = num_hi / div_lo;
+        usi_t q_lo = divlu_si(num_hi % div_lo, num_lo, div_lo, &rem);
+        return (divmod_di_t){rem, ((udi_t)q_hi << 32) | q_lo};
+    }
+
+    // The divisor has more than 32 bits, so the quotient fits in 32 bits.
+    // Estimate it from the normalized upper divisor word; the estimate is at most 1 too low (Hacker's Delight `divDu`).
+    int   shift = clz_si(div_hi);
+    usi_t top   = (divisor << shift) >> 32;
+    udi_t half  = remainder >> 1;
+    usi_t rem;
+    udi_t result = ((udi_t)divlu_si(half >> 32, half, top, &rem) << shift) >> 31;
+    if (result) {
+        result--;
+    }
+    remainder -= result * divisor;
+    if (remainder >= divisor) {
+        result++;
+        remainder -= divisor;
+    }
+    return (divmod_di_t){remainder, result};
+}
+
 // Generate all division functions for a type.
 #define DIVMOD_FUNCS(type, name)                                                                                       \
     u##type __udivmod##name##4(u##type a, u##type b, u##type * rem) {                                                  \
@@ -78,39 +200,20 @@ DIVMOD_IMPL(ti_t, ti)
             *rem = a;                                                                                                  \
             return -1;                                                                                                 \
         }                                                                                                              \
-        bool              div_sign = (a < 0) ^ (b < 0);                                                                \
-        bool              mod_sign = a < b;                                                                            \
-        divmod_##name##_t res      = divmod_##name(a, b);                                                              \
-        *rem                       = mod_sign ? -res.remainder : res.remainder;                                        \
-        return div_sign ? -res.result : res.result;                                                                    \
+        u##type           abs_a = a < 0 ? -(u##type)a : (u##type)a;                                                    \
+        u##type           abs_b = b < 0 ? -(u##type)b : (u##type)b;                                                    \
+        divmod_##name##_t res   = divmod_##name(abs_a, abs_b);                                                         \
+        *rem                    = a < 0 ? -res.remainder : res.remainder;                                              \
+        return (a < 0) ^ (b < 0) ? -res.result : res.result;                                                           \
     }                                                                                                                  \
     type __div##name##3(type a, type b) {                                                                              \
-        if (b == 0)                                                                                                    \
-            return -1;                                                                                                 \
-        bool sign = (a < 0) ^ (b < 0);                                                                                 \
-        if (a < 0)                                                                                                     \
-            a = -a;                                                                                                    \
-        if (b < 0)                                                                                                     \
-            b = -b;                                                                                                    \
-        divmod_##name##_t res = divmod_##name(a, b);                                                                   \
-        if (sign)                                                                                                      \
-            return -res.result;                                                                                        \
-        else                                                                                                           \
-            return res.result;                                                                                         \
+        type rem;                                                                                                      \
+        return __divmod##name##4(a, b, &rem);                                                                          \
     }                                                                                                                  \
     type __mod##name##3(type a, type b) {                                                                              \
-        if (b == 0)                                                                                                    \
-            return a;                                                                                                  \
-        bool sign = a < 0;                                                                                             \
-        if (a < 0)                                                                                                     \
-            a = -a;                                                                                                    \
-        if (b < 0)                                                                                                     \
-            b = -b;                                                                                                    \
-        divmod_##name##_t res = divmod_##name(a, b);                                                                   \
-        if (sign)                                                                                                      \
-            return -res.remainder;                                                                                     \
-        else                                                                                                           \
-            return res.remainder;                                                                                      \
+        type rem;                                                                                                      \
+        __divmod##name##4(a, b, &rem);                                                                                 \
+        return rem;                                                                                                    \
     }
 
 DIVMOD_FUNCS(si_t, si)
@@ -156,3 +259,77 @@ FAKE_OPER(di_t, __muldi3, *)
 #ifdef do_ti_math
 FAKE_OPER(ti_t, __multi3, *)
 #endif
+
+
+// Bit counting routines; GCC calls these for the `__builtin_clz` family when the target lacks the instructions.
+// Defined for zero inputs as well; they return the bit width there, where the builtins are undefined.
+
+// Number of leading zero bits.
+int __clzsi2(usi_t a) {
+    return a ? clz_si(a) : 32;
+}
+
+int __clzdi2(udi_t a) {
+    return a >> 32 ? __clzsi2(a >> 32) : 32 + __clzsi2(a);
+}
+
+// Number of trailing zero bits.
+int __ctzsi2(usi_t a) {
+    return a ? 31 - clz_si(a & -a) : 32;
+}
+
+int __ctzdi2(udi_t a) {
+    return (usi_t)a ? __ctzsi2(a) : 32 + __ctzsi2(a >> 32);
+}
+
+// One plus the index of the least significant set bit, or 0 if none.
+int __ffssi2(usi_t a) {
+    return a ? __ctzsi2(a) + 1 : 0;
+}
+
+int __ffsdi2(udi_t a) {
+    return a ? __ctzdi2(a) + 1 : 0;
+}
+
+// Number of redundant sign bits.
+int __clrsbsi2(si_t a) {
+    return __clzsi2(a < 0 ? ~a : a) - 1;
+}
+
+int __clrsbdi2(di_t a) {
+    return __clzdi2(a < 0 ? ~a : a) - 1;
+}
+
+// Number of set bits.
+int __popcountsi2(usi_t a) {
+    a = a - ((a >> 1) & 0x55555555);
+    a = (a & 0x33333333) + ((a >> 2) & 0x33333333);
+    a = (a + (a >> 4)) & 0x0f0f0f0f;
+    return (a * 0x01010101) >> 24;
+}
+
+int __popcountdi2(udi_t a) {
+    return __popcountsi2(a) + __popcountsi2(a >> 32);
+}
+
+// Parity of the number of set bits.
+int __paritysi2(usi_t a) {
+    a ^= a >> 16;
+    a ^= a >> 8;
+    a ^= a >> 4;
+    return (0x6996 >> (a & 15)) & 1;
+}
+
+int __paritydi2(udi_t a) {
+    return __paritysi2(a ^ (a >> 32));
+}
+
+// Reverse the byte order.
+si_t __bswapsi2(si_t a) {
+    usi_t u = a;
+    return (u >> 24) | ((u >> 8) & 0xff00) | ((u << 8) & 0xff0000) | (u << 24);
+}
+
+di_t __bswapdi2(di_t a) {
+    return ((udi_t)(usi_t)__bswapsi2(a) << 32) | (usi_t)__bswapsi2(a >> 32);
+}
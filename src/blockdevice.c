@@ -0,0 +1,179 @@
+// SPDX-License-Identifier: MIT
+
+#ifdef HAS_BOOTMEDIA_BLKDEV
+
+#include "blockdevice.h"
+
+#include "badge_strings.h"
+
+// Only the read side of the block device API is implemented; the bootloader never writes to boot media.
+
+
+
+// Check that `count` blocks starting at `block` exist.
+static bool blkdev_check_range(badge_err_t *ec, blkdev_t *dev, blksize_t block, blksize_t count) {
+    if (block >= dev->blocks || count > dev->blocks - block) {
+        badge_err_set(ec, ELOC_BLKDEV, ECAUSE_RANGE);
+        return false;
+    }
+    return true;
+}
+
+// Read `len` bytes starting `offset` bytes into `block` from the device itself.
+// Returns whether the read succeeded.
+static bool blkdev_raw_read(badge_err_t *ec, blkdev_t *dev, blksize_t block, size_t offset, uint8_t *buf, size_t len) {
+    switch (dev->type) {
+        case BLKDEV_TYPE_RAM:
+            mem_copy(
+                buf,
+                (uint8_t const *)dev->ram_addr + (size_t)(dev->block_offset + block) * dev->block_size + offset,
+                len
+            );
+            badge_err_set_ok(ec);
+            return true;
+        default:
+            // The bootloader has no I²C EEPROM driver.
+            badge_err_set(ec, ELOC_BLKDEV, ECAUSE_UNSUPPORTED);
+            return false;
+    }
+}
+
+// Get a block from the read cache, or NULL if it is not cached.
+static uint8_t const *blkdev_cache_find(blkdev_t *dev, blksize_t block) {
+    if (!dev->cache_read || !dev->cache) {
+        return NULL;
+    }
+    blkdev_cache_t *cache = dev->cache;
+    for (size_t i = 0; i < cache->cache_depth; i++) {
+        if (cache->block_flags[i].present && cache->block_flags[i].index == block) {
+            cache->block_flags[i].update_time = time_us();
+            return cache->block_cache + i * dev->block_size;
+        }
+    }
+    return NULL;
+}
+
+// Read a block into the least recently used read cache entry.
+// Returns the cached block, or NULL if the read failed.
+static uint8_t const *blkdev_cache_fill(badge_err_t *ec, blkdev_t *dev, blksize_t block) {
+    blkdev_cache_t *cache  = dev->cache;
+    size_t          victim = 0;
+    for (size_t i = 0; i < cache->cache_depth; i++) {
+        if (!cache->block_flags[i].present) {
+            victim = i;
+            break;
+        }
+        if (cache->block_flags[i].update_time < cache->block_flags[victim].update_time) {
+            victim = i;
+        }
+    }
+
+    uint8_t *data                      = cache->block_cache + victim * dev->block_size;
+    cache->block_flags[victim].present = false;
+    if (!blkdev_raw_read(ec, dev, block, 0, data, dev->block_size)) {
+        return NULL;
+    }
+    cache->block_flags[victim] = (blkdev_flags_t){
+        .update_time = time_us(),
+        .index       = block,
+        .present     = true,
+    };
+    return data;
+}
+
+
+
+// Prepare a block device for reading and/or writing.
+// All other `blkdev_*` functions assume the block device was opened using this function.
+// For some block devices, this may allocate caches.
+void blkdev_open(badge_err_t *ec, blkdev_t *dev) {
+    if (!dev->block_size || !dev->blocks) {
+        badge_err_set(ec, ELOC_BLKDEV, ECAUSE_PARAM);
+        return;
+    }
+    if (dev->type != BLKDEV_TYPE_RAM) {
+        badge_err_set(ec, ELOC_BLKDEV, ECAUSE_UNSUPPORTED);
+        return;
+    }
+    if (dev->cache_read && (!dev->cache || !dev->cache->cache_depth)) {
+        // The bootloader cannot allocate a cache; it must be provided statically.
+        badge_err_set(ec, ELOC_BLKDEV, ECAUSE_NOTCONFIG);
+        return;
+    }
+    if (dev->cache) {
+        for (size_t i = 0; i < dev->cache->cache_depth; i++) {
+            dev->cache->block_flags[i].present = false;
+        }
+    }
+    badge_err_set_ok(ec);
+}
+
+// Flush write caches and close block device.
+void blkdev_close(badge_err_t *ec, blkdev_t *dev) {
+    (void)dev;
+    badge_err_set_ok(ec);
+}
+
+// Read a block.
+// This operation may be cached.
+void blkdev_read(badge_err_t *ec, blkdev_t *dev, blksize_t block, uint8_t *readbuf) {
+    blkdev_read_partial(ec, dev, block, 0, readbuf, dev->block_size);
+}
+
+// Read multiple consecutive blocks in a single device transfer.
+// Blocks present in the cache are served from it, the rest bypass the read cache.
+void blkdev_read_n(badge_err_t *ec, blkdev_t *dev, blksize_t block, blksize_t count, uint8_t *readbuf) {
+    if (!blkdev_check_range(ec, dev, block, count)) {
+        return;
+    }
+    blksize_t i = 0;
+    while (i < count) {
+        uint8_t const *cached = blkdev_cache_find(dev, block + i);
+        if (cached) {
+            mem_copy(readbuf + (size_t)i * dev->block_size, cached, dev->block_size);
+            i++;
+            continue;
+        }
+        // Read the run of blocks up to the next cached one in one transfer.
+        blksize_t run = 1;
+        while (i + run < count && !blkdev_cache_find(dev, block + i + run)) {
+            run++;
+        }
+        uint8_t *dest = readbuf + (size_t)i * dev->block_size;
+        if (!blkdev_raw_read(ec, dev, block + i, 0, dest, (size_t)run * dev->block_size)) {
+            return;
+        }
+        i += run;
+    }
+    badge_err_set_ok(ec);
+}
+
+// Partially read a block.
+// This may use read caching if the device doesn't support partial read.
+void blkdev_read_partial(
+    badge_err_t *ec, blkdev_t *dev, blksize_t block, size_t subblock_offset, uint8_t *readbuf, size_t readbuf_len
+) {
+    if (!blkdev_check_range(ec, dev, block, 1)) {
+        return;
+    }
+    if (subblock_offset > dev->block_size || readbuf_len > dev->block_size - subblock_offset) {
+        badge_err_set(ec, ELOC_BLKDEV, ECAUSE_RANGE);
+        return;
+    }
+    uint8_t const *cached = blkdev_cache_find(dev, block);
+    if (!cached && dev->cache_read && dev->cache) {
+        // Keep the whole block; the rest of it is likely read next.
+        cached = blkdev_cache_fill(ec, dev, block);
+        if (!cached) {
+            return;
+        }
+    }
+    if (cached) {
+        mem_copy(readbuf, cached + subblock_offset, readbuf_len);
+        badge_err_set_ok(ec);
+    } else {
+        blkdev_raw_read(ec, dev, block, subblock_offset, readbuf, readbuf_len);
+    }
+}
+
+#endif
@@ -3,6 +3,14 @@
 
 #include "bootmedia.h"
 
+#include "arrays.h"
+#include "badge_strings.h"
+
+// Largest gap between requests that are still read as one transfer.
+#define BOOTMEDIA_MERGE_GAP 64
+// Size of the buffer merged requests are read into.
+#define BOOTMEDIA_MERGE_BUF 512
+
 
 
 // First boot media.
@@ -12,6 +20,9 @@ bootmedia_t *bootmedia_last  = NULL;
 // Number of boot media.
 size_t       bootmedia_num   = 0;
 
+// Buffer merged requests are read into before they are scattered.
+static uint8_t merge_buf[BOOTMEDIA_MERGE_BUF];
+
 // Register a new boot device.
 // This should only be called from constructor functions.
 void bootmedia_register(bootmedia_t *media) {
@@ -32,3 +43,63 @@ void bootmedia_register(bootmedia_t *media) {
         media->prev     = NULL;
     }
 }
+
+// Whether request `a` starts before request `b`.
+static inline bool bootmedia_iov_less(bootmedia_iov_t const *a, bootmedia_iov_t const *b) {
+    return a->offset < b->offset;
+}
+
+ARRAY_SORT_DEFINE(bootmedia_iov_isort, bootmedia_iov_t, bootmedia_iov_less)
+
+// Sort vectored read requests by offset.
+void bootmedia_iov_sort(bootmedia_iov_t *iov, size_t count) {
+    // Batches are small and usually close to sorted already.
+    bootmedia_iov_isort(iov, count);
+}
+
+// Read a batch of requests, sorting them by offset in place.
+// Returns the total number of bytes read.
+diskoff_t bootmedia_readv(bootmedia_t *media, bootmedia_iov_t *iov, size_t count) {
+    if (media->readv) {
+        return media->readv(media, iov, count);
+    }
+    bootmedia_iov_sort(iov, count);
+
+    diskoff_t total = 0;
+    for (size_t i = 0; i < count;) {
+        // Merge the following requests that are close by and fit in the buffer together.
+        diskoff_t start = iov[i].offset;
+        diskoff_t end   = start + iov[i].length;
+        size_t    next  = i + 1;
+        for (; next < count && iov[next].offset <= end + BOOTMEDIA_MERGE_GAP; next++) {
+            diskoff_t req_end = iov[next].offset + iov[next].length;
+            diskoff_t new_end = req_end > end ? req_end : end;
+            if (new_end - start > BOOTMEDIA_MERGE_BUF) {
+                break;
+            }
+            end = new_end;
+        }
+
+        if (next == i + 1) {
+            // A lone request is read directly.
+            diskoff_t got = media->read(media, iov[i].offset, iov[i].length, iov[i].mem);
+            if (got > 0) {
+                total += got;
+            }
+            i = next;
+            continue;
+        }
+
+        // Read the merged range once and scatter it.
+        diskoff_t got = media->read(media, start, end - start, merge_buf);
+        for (; i < next; i++) {
+            diskoff_t skip  = iov[i].offset - start;
+            diskoff_t avail = got - skip < iov[i].length ? got - skip : iov[i].length;
+            if (avail > 0) {
+                mem_copy(iov[i].mem, merge_buf + skip, avail);
+                total += avail;
+            }
+        }
+    }
+    return total;
+}
@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: MIT
+
+#include "dma.h"
+
+#include "badge_strings.h"
+
+
+
+#ifndef HAS_DMA_COPY
+// Synchronous fallback for ports without a DMA copy engine.
+void dma_copy_start(void *dest, void const *src, size_t len) {
+    mem_copy(dest, src, len);
+}
+
+// Synchronous fallback for ports without a DMA copy engine.
+void dma_copy_wait() {
+}
+#endif
+
+// Copy `len` bytes in chunks of `chunk` bytes, calling `func` on each chunk while the next one is copied.
+void dma_copy_chunked(void *dest, void const *src, size_t len, size_t chunk, dma_chunk_func_t func, void *cookie) {
+    uint8_t       *dest_ptr = dest;
+    uint8_t const *src_ptr  = src;
+    size_t         cur      = len < chunk ? len : chunk;
+    dma_copy_start(dest_ptr, src_ptr, cur);
+
+    while (len) {
+        dma_copy_wait();
+        // Start on the next chunk before handing this one to the CPU.
+        size_t next = len - cur < chunk ? len - cur : chunk;
+        if (next) {
+            dma_copy_start(dest_ptr + cur, src_ptr + cur, next);
+        }
+        func(cookie, dest_ptr, cur);
+        dest_ptr += cur;
+        src_ptr  += cur;
+        len      -= cur;
+        cur       = next;
+    }
+}
@@ -3,6 +3,11 @@
 
 #include "filesys.h"
 
+#ifdef HAS_FILE_READAHEAD
+#include "badge_strings.h"
+#include "log.h"
+#endif
+
 
 
 // First filesystem type.
@@ -35,6 +40,62 @@ void filesys_type_register(filesys_type_t *filesys_type) {
 
 
 
+#ifdef HAS_FILE_READAHEAD
+// File reading function that serves small reads from the read-ahead buffer.
+static diskoff_t file_readahead_read(file_t *file, diskoff_t offset, diskoff_t length, void *mem) {
+    file_readahead_t *ra = &file->readahead;
+
+    // Large reads go straight to the destination.
+    if (length >= FILE_READAHEAD_SIZE) {
+        ra->bypasses++;
+        return ra->read(file, offset, length, mem);
+    }
+
+    if (offset >= ra->offset && offset + length <= ra->offset + ra->length) {
+        ra->hits++;
+    } else {
+        // Refill the buffer starting at this read, up to the end of the file.
+        ra->misses++;
+        diskoff_t fill = FILE_READAHEAD_SIZE;
+        if (offset >= 0 && offset <= file->size && file->size - offset < fill) {
+            fill = file->size - offset;
+        }
+        diskoff_t got = ra->read(file, offset, fill, ra->data);
+        if (got < 0) {
+            ra->length = 0;
+            return got;
+        }
+        ra->offset = offset;
+        ra->length = got;
+        if (length > got) {
+            length = got;
+        }
+    }
+
+    mem_copy(mem, ra->data + (offset - ra->offset), length);
+    return length;
+}
+
+// Put the read-ahead buffer in front of an opened file's reading function.
+void file_readahead_init(file_t *file) {
+    file->readahead = (file_readahead_t){.read = file->read};
+    file->read      = file_readahead_read;
+}
+
+// Log the read-ahead statistics of a file.
+void file_readahead_stats(file_t const *file) {
+    logkf(
+        LOG_DEBUG,
+        "File read-ahead: %{u32;d} hits, %{u32;d} misses, %{u32;d} bypassed",
+        file->readahead.hits,
+        file->readahead.misses,
+        file->readahead.bypasses
+    );
+}
+#endif
+
+
+
 #ifdef ALLOW_UNFORMATTED_PARTITION
 // File reading function.
 diskoff_t file_raw_read(file_t *file, diskoff_t offset, diskoff_t length, void *mem) {
@@ -53,6 +114,9 @@ diskoff_t file_raw_read(file_t *file, diskoff_t offset, diskoff_t length, void *
 bool file_raw_mmap(file_t *file, diskoff_t offset, diskoff_t length, size_t vaddr) {
     partition_t *part  = file->filesys->part;
     bootmedia_t *media = part->media;
+    if (!media->mmap) {
+        return false;
+    }
     if (offset < 0 || offset >= part->length) {
         return -1;
     }
@@ -62,6 +126,16 @@ bool file_raw_mmap(file_t *file, diskoff_t offset, diskoff_t length, size_t vadd
     return media->mmap(media, part->offset + offset, length, vaddr);
 }
 
+// File direct address function.
+void const *file_raw_addr(file_t *file, diskoff_t offset, diskoff_t length) {
+    partition_t *part  = file->filesys->part;
+    bootmedia_t *media = part->media;
+    if (!media->addr || offset < 0 || length < 0 || offset + length > part->length) {
+        return NULL;
+    }
+    return media->addr(media, part->offset + offset, length);
+}
+
 // Try to open the kernel file on this filesystem.
 bool filesys_raw_read(partition_t *part, filesys_t *filesys, file_t *file) {
     filesys->part   = part;
@@ -69,6 +143,7 @@ bool filesys_raw_read(partition_t *part, filesys_t *filesys, file_t *file) {
     file->size      = part->length;
     file->read      = file_raw_read;
     file->mmap      = file_raw_mmap;
+    file->addr      = file_raw_addr;
     file->first_sec = part->offset;
     return true;
 }
@@ -76,5 +151,6 @@ bool filesys_raw_read(partition_t *part, filesys_t *filesys, file_t *file) {
 // Dummy filesystem type for unformatted partitions.
 filesys_type_t filesys_type_raw = {
     .read = filesys_raw_read,
+    .hint = PART_FS_RAW,
 };
 #endif
@@ -98,6 +98,11 @@ static diskoff_t appfs_file_action(file_t *file, diskoff_t offset, diskoff_t len
     partition_t *part  = file->filesys->part;
     bootmedia_t *media = part->media;
 
+    if (is_mmap && !media->mmap) {
+        logk(LOG_ERROR, "Media does not support memory mapping");
+        return -1;
+    }
+
     // Bounds checks.
     if (offset < 0 || offset > file->size) {
         logkf(
@@ -207,12 +212,12 @@ static bool filesys_appfs_read(partition_t *part, filesys_t *filesys, file_t *fi
     appfs_hdr_t  hdr0, hdr1;
 
     // Read headers.
-    if (media->read(media, part->offset, sizeof(appfs_hdr_t), &hdr0) != sizeof(appfs_hdr_t)) {
-        logk(LOG_ERROR, "Too few bytes read from media (header 0)");
-        return false;
-    }
-    if (media->read(media, part->offset + PAGE_SIZE / 2, sizeof(appfs_hdr_t), &hdr1) != sizeof(appfs_hdr_t)) {
-        logk(LOG_ERROR, "Too few bytes read from media (header 1)");
+    bootmedia_iov_t iov[] = {
+        {part->offset, sizeof(appfs_hdr_t), &hdr0},
+        {part->offset + PAGE_SIZE / 2, sizeof(appfs_hdr_t), &hdr1},
+    };
+    if (bootmedia_readv(media, iov, 2) != 2 * sizeof(appfs_hdr_t)) {
+        logk(LOG_ERROR, "Too few bytes read from media (headers)");
         return false;
     }
     hdr0_valid = mem_equals(&hdr0.magic, appfs_magic, sizeof(appfs_magic));
@@ -264,6 +269,7 @@ static bool filesys_appfs_read(partition_t *part, filesys_t *filesys, file_t *fi
 static filesys_type_t appfs_filesys = {
     .ident = filesys_appfs_ident,
     .read  = filesys_appfs_read,
+    .hint  = PART_FS_APPFS,
 };
 
 // Register AppFS file system.
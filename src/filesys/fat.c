@@ -0,0 +1,500 @@
+// SPDX-License-Identifier: MIT
+
+#ifdef HAS_FILESYS_FAT
+
+#include "arena.h"
+#include "attributes.h"
+#include "badge_strings.h"
+#include "filesys.h"
+#include "log.h"
+#include "profile.h"
+
+
+
+#ifndef FAT_KERNEL_PATH
+// Path of the kernel file on FAT filesystems.
+#define FAT_KERNEL_PATH "/boot/kernel.bin"
+#endif
+#ifndef FAT_MAX_EXTENTS
+// Maximum number of contiguous runs the kernel file may be fragmented into.
+#define FAT_MAX_EXTENTS 32
+#endif
+
+// Size of the directory and FAT cache windows.
+#define FAT_WINDOW 512
+
+// Directory entry attribute: read-only.
+#define FAT_ATTR_RO     0x01
+// Directory entry attribute: volume label.
+#define FAT_ATTR_VOLUME 0x08
+// Directory entry attribute: subdirectory.
+#define FAT_ATTR_DIR    0x10
+// Directory entry attribute combination: long filename entry.
+#define FAT_ATTR_LFN    0x0f
+
+// FAT boot sector with BIOS parameter block.
+typedef struct PACKED {
+    // x86 jump instruction.
+    uint8_t  jump[3];
+    // OEM name.
+    char     oem[8];
+    // Bytes per sector.
+    uint16_t sect_size;
+    // Sectors per cluster.
+    uint8_t  clus_sects;
+    // Number of reserved sectors, including the boot sector.
+    uint16_t rsvd_sects;
+    // Number of FATs.
+    uint8_t  fats;
+    // Number of root directory entries, FAT12/16 only.
+    uint16_t root_ents;
+    // Total sector count if less than 65536.
+    uint16_t total_sects16;
+    // Media descriptor.
+    uint8_t  media;
+    // Sectors per FAT, FAT12/16 only.
+    uint16_t fat_sects16;
+    // Sectors per track.
+    uint16_t track_sects;
+    // Number of heads.
+    uint16_t heads;
+    // Sectors before this filesystem.
+    uint32_t hidden_sects;
+    // Total sector count if 65536 or more.
+    uint32_t total_sects32;
+    // Sectors per FAT, FAT32 only.
+    uint32_t fat_sects32;
+    // FAT32 extended flags; bit 7 disables mirroring and bits 0-3 select the active FAT.
+    uint16_t ext_flags;
+    // FAT32 version.
+    uint16_t version;
+    // First cluster of the root directory, FAT32 only.
+    uint32_t root_clus;
+} fat_bpb_t;
+
+// FAT directory entry.
+typedef struct PACKED {
+    // 8.3 filename, space-padded.
+    char     name[11];
+    // Attributes.
+    uint8_t  attr;
+    // Reserved for Windows NT.
+    uint8_t  nt_res;
+    // Creation time, tenths of a second.
+    uint8_t  ctime_tenth;
+    // Creation time.
+    uint16_t ctime;
+    // Creation date.
+    uint16_t cdate;
+    // Last access date.
+    uint16_t adate;
+    // First cluster, high 16 bits.
+    uint16_t clus_hi;
+    // Modification time.
+    uint16_t mtime;
+    // Modification date.
+    uint16_t mdate;
+    // First cluster, low 16 bits.
+    uint16_t clus_lo;
+    // File size in bytes.
+    uint32_t size;
+} fat_dirent_t;
+
+// Contiguous run of a file on disk.
+typedef struct {
+    // Offset in the file.
+    diskoff_t file_off;
+    // Offset on the media.
+    diskoff_t disk_off;
+    // Length in bytes.
+    diskoff_t length;
+} fat_extent_t;
+
+// Mounted FAT filesystem state.
+static struct {
+    // FAT type; 12, 16 or 32.
+    int       type;
+    // Media offset of the active FAT.
+    diskoff_t fat_off;
+    // Media offset of the FAT12/16 root directory.
+    diskoff_t root_off;
+    // Number of FAT12/16 root directory entries.
+    uint32_t  root_ents;
+    // First cluster of the FAT32 root directory.
+    uint32_t  root_clus;
+    // Media offset of cluster 2.
+    diskoff_t data_off;
+    // Cluster size in bytes.
+    diskoff_t clus_size;
+    // Number of data clusters.
+    uint32_t  clusters;
+    // Media offset of the cached FAT window, or -1.
+    diskoff_t cache_off;
+    // Cached FAT window.
+    uint8_t   cache[FAT_WINDOW];
+} fat;
+
+// Extents of the kernel file; allocated from the boot arena.
+static fat_extent_t *extents;
+// Number of extents of the kernel file.
+static size_t        extents_num;
+
+
+
+// Read a byte from the active FAT through the FAT cache window.
+static bool fat_byte(bootmedia_t *media, diskoff_t off, uint8_t *out) {
+    diskoff_t window = fat.fat_off + off - (fat.fat_off + off) % FAT_WINDOW;
+    if (window != fat.cache_off) {
+        if (media->read(media, window, FAT_WINDOW, fat.cache) != FAT_WINDOW) {
+            logk(LOG_ERROR, "Too few bytes read from media (FAT)");
+            fat.cache_off = -1;
+            return false;
+        }
+        fat.cache_off = window;
+    }
+    *out = fat.cache[fat.fat_off + off - window];
+    return true;
+}
+
+// Get the next cluster in a chain.
+// Returns 0 at the end of the chain or on error.
+static uint32_t fat_next(bootmedia_t *media, uint32_t clus) {
+    diskoff_t off   = fat.type == 12 ? clus + clus / 2 : clus * (fat.type / 8);
+    uint32_t  value = 0;
+    for (int i = 0; i < fat.type / 8 + (fat.type == 12); i++) {
+        uint8_t tmp;
+        if (!fat_byte(media, off + i, &tmp)) {
+            return 0;
+        }
+        value |= (uint32_t)tmp << (8 * i);
+    }
+
+    if (fat.type == 12) {
+        value = clus & 1 ? value >> 4 : value & 0xfff;
+    } else if (fat.type == 32) {
+        value &= 0x0fffffff;
+    }
+    if (value < 2 || value >= fat.clusters + 2) {
+        // End of chain, free or bad cluster.
+        return 0;
+    }
+    return value;
+}
+
+// Get the media offset of a cluster.
+static inline diskoff_t fat_clus_off(uint32_t clus) {
+    return fat.data_off + (diskoff_t)(clus - 2) * fat.clus_size;
+}
+
+// Search a directory for an 8.3 name.
+// A `dir_clus` of 0 refers to the FAT12/16 root directory.
+static bool fat_find(bootmedia_t *media, uint32_t dir_clus, char const name[11], fat_dirent_t *out) {
+    fat_dirent_t ents[FAT_WINDOW / sizeof(fat_dirent_t)];
+    // Media offset and remaining length of the current directory region.
+    diskoff_t    off;
+    diskoff_t    len;
+    if (dir_clus) {
+        off = fat_clus_off(dir_clus);
+        len = fat.clus_size;
+    } else {
+        off = fat.root_off;
+        len = (diskoff_t)fat.root_ents * (diskoff_t)sizeof(fat_dirent_t);
+    }
+
+    // Bound the walk in case the chain loops.
+    for (uint32_t hops = 0; hops <= fat.clusters;) {
+        while (len > 0) {
+            diskoff_t chunk = len < FAT_WINDOW ? len : FAT_WINDOW;
+            if (media->read(media, off, chunk, ents) != chunk) {
+                logk(LOG_ERROR, "Too few bytes read from media (directory)");
+                return false;
+            }
+            for (size_t i = 0; i < chunk / sizeof(fat_dirent_t); i++) {
+                if (ents[i].name[0] == 0) {
+                    // End of directory.
+                    return false;
+                } else if ((uint8_t)ents[i].name[0] == 0xe5 || ents[i].attr == FAT_ATTR_LFN ||
+                           (ents[i].attr & FAT_ATTR_VOLUME)) {
+                    // Deleted, long filename or volume label entry.
+                    continue;
+                } else if (mem_equals(ents[i].name, name, 11)) {
+                    *out = ents[i];
+                    return true;
+                }
+            }
+            off += chunk;
+            len -= chunk;
+        }
+
+        // Move on to the next cluster of the directory.
+        if (!dir_clus) {
+            return false;
+        }
+        dir_clus = fat_next(media, dir_clus);
+        if (!dir_clus) {
+            return false;
+        }
+        off = fat_clus_off(dir_clus);
+        len = fat.clus_size;
+        hops++;
+    }
+    return false;
+}
+
+// Convert the next component of `path` to an 8.3 name.
+// Returns the number of characters consumed, or 0 at the end of the path.
+static size_t fat_path_component(char const *path, char name[11]) {
+    size_t i = 0;
+    while (path[i] == '/') i++;
+    if (!path[i]) {
+        return 0;
+    }
+
+    mem_set(name, ' ', 11);
+    size_t pos = 0;
+    size_t max = 8;
+    for (; path[i] && path[i] != '/'; i++) {
+        if (path[i] == '.' && max == 8) {
+            pos = 8;
+            max = 11;
+        } else if (pos < max) {
+            name[pos++] = ascii_char_to_upper(path[i]);
+        }
+    }
+    return i;
+}
+
+// Build the extent list of a file from its cluster chain.
+static bool fat_build_extents(bootmedia_t *media, uint32_t clus, diskoff_t size) {
+    extents_num = 0;
+    // The file cannot have more runs than clusters.
+    diskoff_t clusters = (size + fat.clus_size - 1) / fat.clus_size;
+    size_t    max      = clusters < FAT_MAX_EXTENTS ? clusters : FAT_MAX_EXTENTS;
+    extents            = arena_alloc(max * sizeof(*extents), sizeof(diskoff_t));
+    if (!extents) {
+        return false;
+    }
+
+    diskoff_t file_off = 0;
+    while (file_off < size) {
+        if (clus < 2) {
+            logk(LOG_ERROR, "FAT cluster chain shorter than file");
+            return false;
+        }
+        diskoff_t disk_off = fat_clus_off(clus);
+        if (extents_num && extents[extents_num - 1].disk_off + extents[extents_num - 1].length == disk_off) {
+            // Cluster continues the current run.
+            extents[extents_num - 1].length += fat.clus_size;
+        } else if (extents_num < max) {
+            // Cluster starts a new run.
+            extents[extents_num++] = (fat_extent_t){
+                .file_off = file_off,
+                .disk_off = disk_off,
+                .length   = fat.clus_size,
+            };
+        } else {
+            logkf(LOG_ERROR, "Kernel file has more than %{size;d} fragments", (size_t)FAT_MAX_EXTENTS);
+            return false;
+        }
+        file_off += fat.clus_size;
+        clus      = fat_next(media, clus);
+    }
+    return true;
+}
+
+
+
+// File action function.
+static diskoff_t fat_file_action(file_t *file, diskoff_t offset, diskoff_t length, void *mem, bool is_mmap) {
+    partition_t *part  = file->filesys->part;
+    bootmedia_t *media = part->media;
+
+    if (is_mmap && !media->mmap) {
+        logk(LOG_ERROR, "Media does not support memory mapping");
+        return -1;
+    }
+
+    // Bounds checks.
+    if (offset < 0 || offset > file->size || length < 0) {
+        logkf(
+            LOG_WARN,
+            "%{cs} at %{" FMT_TYPE_DISKOFF ";d} length %{" FMT_TYPE_DISKOFF ";d} out of bounds",
+            is_mmap ? "mmap" : "read",
+            offset,
+            length
+        );
+        return -1;
+    }
+    if (offset + length > file->size) {
+        length = file->size - offset;
+    }
+
+    // Issue one media request per extent touched.
+    uint8_t  *ptr  = mem;
+    diskoff_t read = 0;
+    for (size_t i = 0; i < extents_num && length > 0; i++) {
+        fat_extent_t const *ext = &extents[i];
+        if (offset >= ext->file_off + ext->length) {
+            continue;
+        }
+        diskoff_t start = offset - ext->file_off;
+        diskoff_t chunk = ext->length - start < length ? ext->length - start : length;
+        if (is_mmap) {
+            if (!media->mmap(media, ext->disk_off + start, chunk, (size_t)mem + read)) {
+                break;
+            }
+        } else if (media->read(media, ext->disk_off + start, chunk, ptr + read) != chunk) {
+            break;
+        }
+        offset += chunk;
+        length -= chunk;
+        read   += chunk;
+    }
+
+    return read;
+}
+
+// File reading function.
+static diskoff_t fat_file_read(file_t *file, diskoff_t offset, diskoff_t length, void *mem) {
+    PROFILE_SCOPE(read_fat);
+    return fat_file_action(file, offset, length, mem, false);
+}
+
+// File memory mapping function.
+static bool fat_file_mmap(file_t *file, diskoff_t offset, diskoff_t length, size_t vaddr) {
+    return fat_file_action(file, offset, length, (void *)vaddr, true) == length;
+}
+
+// Read and validate the BIOS parameter block.
+static bool fat_read_bpb(partition_t *part, fat_bpb_t *bpb) {
+    bootmedia_t *media = part->media;
+    uint8_t      sig[2];
+    if (media->read(media, part->offset, sizeof(fat_bpb_t), bpb) != sizeof(fat_bpb_t) ||
+        media->read(media, part->offset + 510, 2, sig) != 2) {
+        logk(LOG_WARN, "Too few bytes read from media (boot sector)");
+        return false;
+    }
+    return sig[0] == 0x55 && sig[1] == 0xaa && bpb->sect_size >= 512 && bpb->sect_size <= 4096 &&
+           !(bpb->sect_size & (bpb->sect_size - 1)) && bpb->clus_sects &&
+           !(bpb->clus_sects & (bpb->clus_sects - 1)) && bpb->rsvd_sects && bpb->fats &&
+           (bpb->media == 0xf0 || bpb->media >= 0xf8);
+}
+
+// Try to identify a filesystem.
+static bool filesys_fat_ident(partition_t *part) {
+    fat_bpb_t bpb;
+    return fat_read_bpb(part, &bpb);
+}
+
+// Try to open the kernel file on this filesystem.
+static bool filesys_fat_read(partition_t *part, filesys_t *filesys, file_t *file) {
+    logk(LOG_INFO, "Trying FAT filesystem");
+
+    bootmedia_t *media = part->media;
+    fat_bpb_t    bpb;
+    if (!fat_read_bpb(part, &bpb)) {
+        return false;
+    }
+
+    // Compute the filesystem layout.
+    diskoff_t sect_size  = bpb.sect_size;
+    uint32_t  fat_sects  = bpb.fat_sects16 ? bpb.fat_sects16 : bpb.fat_sects32;
+    uint32_t  total      = bpb.total_sects16 ? bpb.total_sects16 : bpb.total_sects32;
+    uint32_t  root_sects = (bpb.root_ents * sizeof(fat_dirent_t) + sect_size - 1) / sect_size;
+    uint32_t  data_sect  = bpb.rsvd_sects + bpb.fats * fat_sects + root_sects;
+    if (!fat_sects || data_sect >= total || (diskoff_t)total * sect_size > part->length) {
+        logk(LOG_ERROR, "Invalid FAT filesystem geometry");
+        return false;
+    }
+    fat.clusters  = (total - data_sect) / bpb.clus_sects;
+    fat.type      = fat.clusters < 4085 ? 12 : fat.clusters < 65525 ? 16 : 32;
+    fat.clus_size = sect_size * bpb.clus_sects;
+    fat.root_off  = part->offset + (bpb.rsvd_sects + bpb.fats * fat_sects) * sect_size;
+    fat.root_ents = bpb.root_ents;
+    fat.root_clus = fat.type == 32 ? bpb.root_clus : 0;
+    fat.data_off  = part->offset + data_sect * sect_size;
+    fat.cache_off = -1;
+
+    // Select the active FAT.
+    filesys->part       = part;
+    filesys->sect_size  = sect_size;
+    filesys->active_fat = 0;
+    if (fat.type == 32 && (bpb.ext_flags & 0x80) && (bpb.ext_flags & 15) < bpb.fats) {
+        filesys->active_fat = bpb.ext_flags & 15;
+    }
+    fat.fat_off = part->offset + (bpb.rsvd_sects + filesys->active_fat * fat_sects) * sect_size;
+    logkf(
+        LOG_INFO,
+        "FAT%{d} with %{u32;d} clusters of %{u32;d} bytes",
+        fat.type,
+        fat.clusters,
+        (uint32_t)fat.clus_size
+    );
+
+    // Walk the kernel path.
+    char const  *path = FAT_KERNEL_PATH;
+    uint32_t     dir  = fat.root_clus;
+    fat_dirent_t ent  = {0};
+    char         name[11];
+    size_t       consumed;
+    while ((consumed = fat_path_component(path, name))) {
+        path += consumed;
+        if (!fat_find(media, dir, name, &ent)) {
+            logk(LOG_INFO, "Kernel file " FAT_KERNEL_PATH " not found");
+            return false;
+        }
+        dir = ((uint32_t)ent.clus_hi << 16) | ent.clus_lo;
+        if (fat.type != 32) {
+            dir &= 0xffff;
+        }
+        if (fat_path_component(path, name) && !(ent.attr & FAT_ATTR_DIR)) {
+            logk(LOG_ERROR, "Kernel path component is not a directory");
+            return false;
+        }
+    }
+    if (ent.attr & FAT_ATTR_DIR) {
+        logk(LOG_ERROR, "Kernel path is a directory");
+        return false;
+    }
+
+    // Cache the cluster chain as contiguous runs.
+    if (!fat_build_extents(media, dir, ent.size)) {
+        return false;
+    }
+    logkf(
+        LOG_INFO,
+        "Kernel file is %{u32;d} bytes in %{size;d} extent%{c}",
+        ent.size,
+        extents_num,
+        extents_num != 1 ? 's' : 0
+    );
+
+    // Construct handles.
+    file->filesys   = filesys;
+    file->size      = ent.size;
+    file->read      = fat_file_read;
+    file->mmap      = fat_file_mmap;
+    file->inode     = 0;
+    file->first_sec = dir;
+    file->cur_off   = 0;
+    file->cur_sec   = dir;
+
+    return true;
+}
+
+
+
+// FAT file system.
+static filesys_type_t fat_filesys = {
+    .ident = filesys_fat_ident,
+    .read  = filesys_fat_read,
+    .hint  = PART_FS_FAT,
+};
+
+// Register FAT file system.
+static void register_fat_filesys() __attribute__((constructor));
+static void register_fat_filesys() {
+    filesys_type_register(&fat_filesys);
+}
+
+#endif
@@ -0,0 +1,600 @@
+// SPDX-License-Identifier: MIT
+
+#ifdef HAS_FILESYS_LITTLEFS
+
+#include "arena.h"
+#include "badge_strings.h"
+#include "checksum.h"
+#include "filesys.h"
+#include "log.h"
+
+
+
+#ifndef LFS_KERNEL_PATH
+// Path of the kernel file on LittleFS filesystems.
+#define LFS_KERNEL_PATH "/boot/kernel.bin"
+#endif
+#ifndef LFS_BLOCK_SIZE
+// LittleFS block size; must match the filesystem.
+#define LFS_BLOCK_SIZE 4096
+#endif
+#ifndef LFS_CACHE_BLOCKS
+// Number of metadata blocks cached.
+#define LFS_CACHE_BLOCKS 2
+#endif
+#ifndef LFS_MAX_DIR_ENTS
+// Maximum number of entries in a single metadata block.
+#define LFS_MAX_DIR_ENTS 64
+#endif
+#ifndef LFS_MAX_FILE_BLOCKS
+// Maximum number of blocks the kernel file may occupy.
+#define LFS_MAX_FILE_BLOCKS 512
+#endif
+
+// Tag type: name of a regular file.
+#define LFS_TYPE_REG          0x001
+// Tag type: name of a directory.
+#define LFS_TYPE_DIR          0x002
+// Tag type: name of the superblock.
+#define LFS_TYPE_SUPERBLOCK   0x0ff
+// Tag type: directory metadata pair.
+#define LFS_TYPE_DIRSTRUCT    0x200
+// Tag type: inline file data.
+#define LFS_TYPE_INLINESTRUCT 0x201
+// Tag type: CTZ skip-list file.
+#define LFS_TYPE_CTZSTRUCT    0x202
+// Tag type: create an entry.
+#define LFS_TYPE_CREATE       0x401
+// Tag type: delete an entry.
+#define LFS_TYPE_DELETE       0x4ff
+
+// Get the 3-bit type class of a tag.
+#define LFS_TAG_TYPE1(tag) (((tag) >> 20) & 0x700)
+// Get the 11-bit type of a tag.
+#define LFS_TAG_TYPE3(tag) (((tag) >> 20) & 0x7ff)
+// Get the entry ID of a tag.
+#define LFS_TAG_ID(tag)    (((tag) >> 10) & 0x3ff)
+// Get the data size of a tag.
+#define LFS_TAG_SIZE(tag)  ((tag) & 0x3ff)
+// Whether a tag is a commit CRC.
+#define LFS_TAG_IS_CRC(tag) (((tag) & 0x78000000) == 0x50000000)
+// Get the on-disk size of a tag including its data; deleted tags have no data.
+#define LFS_TAG_DSIZE(tag) (4 + (LFS_TAG_SIZE(tag) == 0x3ff ? 0 : LFS_TAG_SIZE(tag)))
+
+// Cached metadata block.
+typedef struct {
+    // Block number.
+    uint32_t block;
+    // Last use for replacement.
+    uint32_t used;
+    // Entry contains data.
+    bool     present;
+} lfs_cache_t;
+
+// Directory entry in a metadata block.
+typedef struct {
+    // Offset of the name in the metadata block.
+    uint16_t name_off;
+    // Length of the name.
+    uint16_t name_len;
+    // Name tag type; one of `LFS_TYPE_REG`, `LFS_TYPE_DIR` or `LFS_TYPE_SUPERBLOCK`.
+    uint16_t type;
+    // Struct tag type; one of `LFS_TYPE_*STRUCT` or 0 if none.
+    uint16_t struct_type;
+    // Struct data; metadata pair, CTZ head and size, or inline data offset and size.
+    uint32_t struct_data[2];
+} lfs_ent_t;
+
+// Fetched metadata block.
+typedef struct {
+    // Block number.
+    uint32_t       block;
+    // Block contents.
+    uint8_t const *data;
+    // Number of entries.
+    size_t         count;
+    // Directory continues in the tail pair.
+    bool           split;
+    // Tail metadata pair.
+    uint32_t       tail[2];
+    // Entries.
+    lfs_ent_t      ents[LFS_MAX_DIR_ENTS];
+} lfs_dir_t;
+
+// Mounted LittleFS state.
+static struct {
+    // Media offset of the partition.
+    diskoff_t part_off;
+    // Number of blocks.
+    uint32_t  block_count;
+    // Media offset of inline file data, or -1 for CTZ files.
+    diskoff_t inline_off;
+} lfs;
+
+// Metadata block cache entries.
+static lfs_cache_t cache[LFS_CACHE_BLOCKS];
+// Metadata block cache data; allocated from the boot arena on mount.
+static uint8_t    *cache_data;
+// Metadata block cache use counter.
+static uint32_t    cache_clock;
+// Metadata block being searched.
+static lfs_dir_t   dir;
+// Precomputed CTZ block list of the kernel file; allocated from the boot arena.
+static uint32_t   *blocks;
+// Number of blocks of the kernel file.
+static size_t      blocks_num;
+
+
+
+// Read a little-endian 32-bit word.
+static inline uint32_t lfs_le32(uint8_t const *ptr) {
+    return ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+}
+
+// Read a big-endian 32-bit word.
+static inline uint32_t lfs_be32(uint8_t const *ptr) {
+    return ((uint32_t)ptr[0] << 24) | (ptr[1] << 16) | (ptr[2] << 8) | ptr[3];
+}
+
+// Count set bits.
+static inline uint32_t lfs_popc(uint32_t val) {
+    uint32_t count = 0;
+    for (; val; val &= val - 1) count++;
+    return count;
+}
+
+// Convert a CTZ file offset to a block index and in-block offset.
+static uint32_t lfs_ctz_index(uint32_t *off) {
+    uint32_t size = *off;
+    uint32_t b    = LFS_BLOCK_SIZE - 2 * 4;
+    uint32_t i    = size / b;
+    if (i == 0) {
+        return 0;
+    }
+    i    = (size - 4 * (lfs_popc(i - 1) + 2)) / b;
+    *off = size - b * i - 4 * lfs_popc(i);
+    return i;
+}
+
+// Get a metadata block through the cache.
+static uint8_t const *lfs_block(bootmedia_t *media, uint32_t block) {
+    if (block >= lfs.block_count) {
+        logkf(LOG_ERROR, "LittleFS block %{u32;d} out of range", block);
+        return NULL;
+    }
+
+    // Look for a hit or else the least recently used entry.
+    size_t victim = 0;
+    for (size_t i = 0; i < LFS_CACHE_BLOCKS; i++) {
+        if (cache[i].present && cache[i].block == block) {
+            cache[i].used = ++cache_clock;
+            return cache_data + i * LFS_BLOCK_SIZE;
+        }
+        if (!cache[i].present || cache[i].used < cache[victim].used) {
+            victim = i;
+        }
+    }
+
+    diskoff_t off = lfs.part_off + (diskoff_t)block * LFS_BLOCK_SIZE;
+    if (media->read(media, off, LFS_BLOCK_SIZE, cache_data + victim * LFS_BLOCK_SIZE) != LFS_BLOCK_SIZE) {
+        logk(LOG_ERROR, "Too few bytes read from media (metadata)");
+        cache[victim].present = false;
+        return NULL;
+    }
+    cache[victim].block   = block;
+    cache[victim].used    = ++cache_clock;
+    cache[victim].present = true;
+    return cache_data + victim * LFS_BLOCK_SIZE;
+}
+
+// Find the end of the last commit with a valid CRC in a metadata block.
+// Returns 0 if there are no valid commits.
+static uint32_t lfs_commit_end(uint8_t const *data) {
+    uint32_t off  = 4;
+    uint32_t ptag = 0xffffffff;
+    uint32_t end  = 0;
+    crc32_t  crc  = _crc32_update(crc32_init(), data, 4);
+    while (off + 4 <= LFS_BLOCK_SIZE) {
+        crc          = _crc32_update(crc, data + off, 4);
+        uint32_t tag = lfs_be32(data + off) ^ ptag;
+        if (tag & 0x80000000) {
+            break;
+        }
+        uint32_t dsize = LFS_TAG_DSIZE(tag);
+        if (off + dsize > LFS_BLOCK_SIZE) {
+            break;
+        }
+        ptag = tag;
+        if (LFS_TAG_IS_CRC(tag)) {
+            if (dsize < 8 || crc != lfs_le32(data + off + 4)) {
+                break;
+            }
+            // The CRC tag's chunk selects the valid bit polarity of the next commit.
+            ptag ^= ((tag >> 20) & 1) << 31;
+            end   = off + dsize;
+            crc   = crc32_init();
+        } else {
+            crc = _crc32_update(crc, data + off + 4, dsize - 4);
+        }
+        off += dsize;
+    }
+    return end;
+}
+
+// Replay the committed tags of a metadata block into `dir`.
+static bool lfs_replay(uint8_t const *data, uint32_t end) {
+    uint32_t off  = 4;
+    uint32_t ptag = 0xffffffff;
+    dir.count     = 0;
+    dir.split     = false;
+    dir.tail[0]   = 0xffffffff;
+    dir.tail[1]   = 0xffffffff;
+
+    while (off < end) {
+        uint32_t tag  = lfs_be32(data + off) ^ ptag;
+        uint32_t type = LFS_TAG_TYPE3(tag);
+        uint32_t id   = LFS_TAG_ID(tag);
+        uint32_t size = LFS_TAG_SIZE(tag);
+        ptag          = tag;
+
+        if (LFS_TAG_IS_CRC(tag)) {
+            ptag ^= ((tag >> 20) & 1) << 31;
+        } else if (LFS_TAG_TYPE1(tag) == 0x000 || LFS_TAG_TYPE1(tag) == 0x200 || type == LFS_TYPE_CREATE) {
+            if (id >= LFS_MAX_DIR_ENTS) {
+                logk(LOG_ERROR, "Too many entries in LittleFS metadata block");
+                return false;
+            }
+            if (type == LFS_TYPE_CREATE) {
+                // Insert a new entry, shifting the later entries up.
+                if (dir.count >= LFS_MAX_DIR_ENTS) {
+                    logk(LOG_ERROR, "Too many entries in LittleFS metadata block");
+                    return false;
+                }
+                if (id < dir.count) {
+                    mem_copy(&dir.ents[id + 1], &dir.ents[id], (dir.count - id) * sizeof(lfs_ent_t));
+                }
+                mem_set(&dir.ents[id], 0, sizeof(lfs_ent_t));
+                dir.count = (id < dir.count ? dir.count : id) + 1;
+            } else if (id >= dir.count) {
+                // Older versions create entries implicitly.
+                mem_set(&dir.ents[dir.count], 0, (id + 1 - dir.count) * sizeof(lfs_ent_t));
+                dir.count = id + 1;
+            }
+            if (LFS_TAG_TYPE1(tag) == 0x000) {
+                dir.ents[id].name_off = off + 4;
+                dir.ents[id].name_len = size;
+                dir.ents[id].type     = type;
+            } else if (LFS_TAG_TYPE1(tag) == 0x200) {
+                dir.ents[id].struct_type = type;
+                if (type == LFS_TYPE_INLINESTRUCT) {
+                    dir.ents[id].struct_data[0] = off + 4;
+                    dir.ents[id].struct_data[1] = size == 0x3ff ? 0 : size;
+                } else if (size >= 8) {
+                    dir.ents[id].struct_data[0] = lfs_le32(data + off + 4);
+                    dir.ents[id].struct_data[1] = lfs_le32(data + off + 8);
+                }
+            }
+        } else if (type == LFS_TYPE_DELETE) {
+            // Remove an entry, shifting the later entries down.
+            if (id < dir.count) {
+                mem_copy(&dir.ents[id], &dir.ents[id + 1], (dir.count - id - 1) * sizeof(lfs_ent_t));
+                dir.count--;
+            }
+        } else if (LFS_TAG_TYPE1(tag) == 0x600 && size >= 8) {
+            // Soft tails link directories, hard tails continue this directory.
+            dir.split   = type & 1;
+            dir.tail[0] = lfs_le32(data + off + 4);
+            dir.tail[1] = lfs_le32(data + off + 8);
+        }
+
+        off += LFS_TAG_DSIZE(tag);
+    }
+    return true;
+}
+
+// Fetch the newest valid block of a metadata pair into `dir`.
+static bool lfs_fetch(bootmedia_t *media, uint32_t const pair[2]) {
+    uint8_t const *data[2];
+    for (int i = 0; i < 2; i++) {
+        data[i] = lfs_block(media, pair[i]);
+        if (!data[i]) {
+            return false;
+        }
+    }
+
+    // Try the block with the newer revision count first.
+    int first = (int32_t)(lfs_le32(data[1]) - lfs_le32(data[0])) > 0;
+    for (int i = 0; i < 2; i++) {
+        int            sel = first ^ i;
+        // Blocks may have been evicted when the cache holds fewer than two.
+        uint8_t const *blk = lfs_block(media, pair[sel]);
+        uint32_t       end = blk ? lfs_commit_end(blk) : 0;
+        if (end) {
+            dir.block = pair[sel];
+            dir.data  = blk;
+            return lfs_replay(blk, end);
+        }
+    }
+
+    logkf(LOG_ERROR, "LittleFS metadata pair %{u32;d},%{u32;d} corrupted", pair[0], pair[1]);
+    return false;
+}
+
+// Search a directory, including its hard tails, for a name.
+// On success, `dir` holds the metadata block the entry was found in.
+static lfs_ent_t const *lfs_find(bootmedia_t *media, uint32_t const pair[2], char const *name, size_t name_len) {
+    uint32_t cur[2] = {pair[0], pair[1]};
+    // Bound the walk in case the tails loop.
+    for (uint32_t hops = 0; hops < lfs.block_count; hops++) {
+        if (!lfs_fetch(media, cur)) {
+            return NULL;
+        }
+        for (size_t i = 0; i < dir.count; i++) {
+            lfs_ent_t const *ent = &dir.ents[i];
+            if ((ent->type == LFS_TYPE_REG || ent->type == LFS_TYPE_DIR) && ent->name_len == name_len &&
+                mem_equals(dir.data + ent->name_off, name, name_len)) {
+                return ent;
+            }
+        }
+        if (!dir.split) {
+            return NULL;
+        }
+        cur[0] = dir.tail[0];
+        cur[1] = dir.tail[1];
+    }
+    return NULL;
+}
+
+// Precompute the block list of a CTZ skip-list file.
+static bool lfs_build_blocks(bootmedia_t *media, uint32_t head, uint32_t size) {
+    blocks_num = 0;
+    if (!size) {
+        return true;
+    }
+
+    uint32_t off   = size - 1;
+    uint32_t index = lfs_ctz_index(&off);
+    if (index >= LFS_MAX_FILE_BLOCKS) {
+        logkf(LOG_ERROR, "Kernel file has more than %{size;d} blocks", (size_t)LFS_MAX_FILE_BLOCKS);
+        return false;
+    }
+    blocks = arena_alloc((index + 1) * sizeof(*blocks), sizeof(*blocks));
+    if (!blocks) {
+        return false;
+    }
+
+    // The first pointer of every block refers to the previous block.
+    blocks[index] = head;
+    for (uint32_t i = index; i > 0; i--) {
+        if (blocks[i] >= lfs.block_count) {
+            logkf(LOG_ERROR, "LittleFS block %{u32;d} out of range", blocks[i]);
+            return false;
+        }
+        uint8_t ptr[4];
+        if (media->read(media, lfs.part_off + (diskoff_t)blocks[i] * LFS_BLOCK_SIZE, 4, ptr) != 4) {
+            logk(LOG_ERROR, "Too few bytes read from media (CTZ pointer)");
+            return false;
+        }
+        blocks[i - 1] = lfs_le32(ptr);
+    }
+    if (blocks[0] >= lfs.block_count) {
+        logkf(LOG_ERROR, "LittleFS block %{u32;d} out of range", blocks[0]);
+        return false;
+    }
+
+    blocks_num = index + 1;
+    return true;
+}
+
+
+
+// File action function.
+static diskoff_t lfs_file_action(file_t *file, diskoff_t offset, diskoff_t length, void *mem, bool is_mmap) {
+    partition_t *part  = file->filesys->part;
+    bootmedia_t *media = part->media;
+
+    if (is_mmap && !media->mmap) {
+        logk(LOG_ERROR, "Media does not support memory mapping");
+        return -1;
+    }
+
+    // Bounds checks.
+    if (offset < 0 || offset > file->size || length < 0) {
+        logkf(
+            LOG_WARN,
+            "%{cs} at %{" FMT_TYPE_DISKOFF ";d} length %{" FMT_TYPE_DISKOFF ";d} out of bounds",
+            is_mmap ? "mmap" : "read",
+            offset,
+            length
+        );
+        return -1;
+    }
+    if (offset + length > file->size) {
+        length = file->size - offset;
+    }
+
+    // Issue one media request per block touched.
+    uint8_t  *ptr  = mem;
+    diskoff_t read = 0;
+    while (length > 0) {
+        diskoff_t disk_off;
+        diskoff_t chunk;
+        if (lfs.inline_off >= 0) {
+            disk_off = lfs.inline_off + offset;
+            chunk    = length;
+        } else {
+            uint32_t in_block = offset;
+            uint32_t index    = lfs_ctz_index(&in_block);
+            if (index >= blocks_num) {
+                break;
+            }
+            disk_off = lfs.part_off + (diskoff_t)blocks[index] * LFS_BLOCK_SIZE + in_block;
+            chunk    = (diskoff_t)(LFS_BLOCK_SIZE - in_block);
+            if (chunk > length) {
+                chunk = length;
+            }
+        }
+
+        if (is_mmap) {
+            if (!media->mmap(media, disk_off, chunk, (size_t)mem + read)) {
+                break;
+            }
+        } else if (media->read(media, disk_off, chunk, ptr + read) != chunk) {
+            break;
+        }
+        offset += chunk;
+        length -= chunk;
+        read   += chunk;
+    }
+
+    return read;
+}
+
+// File reading function.
+static diskoff_t lfs_file_read(file_t *file, diskoff_t offset, diskoff_t length, void *mem) {
+    return lfs_file_action(file, offset, length, mem, false);
+}
+
+// File memory mapping function.
+static bool lfs_file_mmap(file_t *file, diskoff_t offset, diskoff_t length, size_t vaddr) {
+    return lfs_file_action(file, offset, length, (void *)vaddr, true) == length;
+}
+
+// Try to identify a filesystem.
+static bool filesys_lfs_ident(partition_t *part) {
+    bootmedia_t *media = part->media;
+    // The superblock name directly follows the revision count and first tag.
+    for (int i = 0; i < 2; i++) {
+        char magic[8];
+        if (media->read(media, part->offset + i * LFS_BLOCK_SIZE + 8, sizeof(magic), magic) != sizeof(magic)) {
+            logk(LOG_WARN, "Too few bytes read from media (superblock)");
+            return false;
+        }
+        if (mem_equals(magic, "littlefs", sizeof(magic))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Try to open the kernel file on this filesystem.
+static bool filesys_lfs_read(partition_t *part, filesys_t *filesys, file_t *file) {
+    logk(LOG_INFO, "Trying LittleFS filesystem");
+
+    bootmedia_t *media = part->media;
+    lfs.part_off       = part->offset;
+    lfs.block_count    = part->length / LFS_BLOCK_SIZE;
+    lfs.inline_off     = -1;
+    cache_data         = arena_alloc(LFS_CACHE_BLOCKS * LFS_BLOCK_SIZE, 4);
+    if (!cache_data) {
+        return false;
+    }
+    for (size_t i = 0; i < LFS_CACHE_BLOCKS; i++) {
+        cache[i].present = false;
+    }
+
+    // Read the superblock from the root metadata pair.
+    uint32_t pair[2] = {0, 1};
+    if (!lfs_fetch(media, pair)) {
+        return false;
+    }
+    if (!dir.count || dir.ents[0].type != LFS_TYPE_SUPERBLOCK ||
+        dir.ents[0].struct_type != LFS_TYPE_INLINESTRUCT || dir.ents[0].struct_data[1] < 12) {
+        logk(LOG_ERROR, "LittleFS superblock not found");
+        return false;
+    }
+    uint8_t const *sb         = dir.data + dir.ents[0].struct_data[0];
+    uint32_t       block_size = lfs_le32(sb + 4);
+    uint32_t       count      = lfs_le32(sb + 8);
+    if (block_size != LFS_BLOCK_SIZE) {
+        logkf(LOG_ERROR, "LittleFS block size %{u32;d} unsupported; set LFS_BLOCK_SIZE", block_size);
+        return false;
+    }
+    if (count < lfs.block_count) {
+        lfs.block_count = count;
+    }
+    filesys->part      = part;
+    filesys->sect_size = LFS_BLOCK_SIZE;
+
+    // Walk the kernel path.
+    char const      *path = LFS_KERNEL_PATH;
+    lfs_ent_t const *ent  = NULL;
+    while (*path) {
+        while (*path == '/') path++;
+        size_t len = 0;
+        while (path[len] && path[len] != '/') len++;
+        if (!len) {
+            break;
+        }
+        if (ent) {
+            if (ent->type != LFS_TYPE_DIR || ent->struct_type != LFS_TYPE_DIRSTRUCT) {
+                logk(LOG_ERROR, "Kernel path component is not a directory");
+                return false;
+            }
+            pair[0] = ent->struct_data[0];
+            pair[1] = ent->struct_data[1];
+        }
+        ent = lfs_find(media, pair, path, len);
+        if (!ent) {
+            logk(LOG_INFO, "Kernel file " LFS_KERNEL_PATH " not found");
+            return false;
+        }
+        path += len;
+    }
+    if (!ent || ent->type != LFS_TYPE_REG) {
+        logk(LOG_ERROR, "Kernel path is not a file");
+        return false;
+    }
+
+    // Resolve the file data once.
+    uint32_t size;
+    if (ent->struct_type == LFS_TYPE_INLINESTRUCT) {
+        size           = ent->struct_data[1];
+        lfs.inline_off = lfs.part_off + (diskoff_t)dir.block * LFS_BLOCK_SIZE + ent->struct_data[0];
+        blocks_num     = 0;
+    } else if (ent->struct_type == LFS_TYPE_CTZSTRUCT) {
+        size = ent->struct_data[1];
+        if (!lfs_build_blocks(media, ent->struct_data[0], size)) {
+            return false;
+        }
+    } else {
+        logk(LOG_ERROR, "Kernel file has no data");
+        return false;
+    }
+    logkf(
+        LOG_INFO,
+        "Kernel file is %{u32;d} bytes in %{size;d} block%{c}",
+        size,
+        blocks_num,
+        blocks_num != 1 ? 's' : 0
+    );
+
+    // Construct handles.
+    file->filesys   = filesys;
+    file->size      = size;
+    file->read      = lfs_file_read;
+    file->mmap      = lfs_file_mmap;
+    file->inode     = 0;
+    file->first_sec = blocks_num ? blocks[0] : dir.block;
+    file->cur_off   = 0;
+    file->cur_sec   = file->first_sec;
+
+    return true;
+}
+
+
+
+// LittleFS file system.
+static filesys_type_t lfs_filesys = {
+    .ident = filesys_lfs_ident,
+    .read  = filesys_lfs_read,
+    .hint  = PART_FS_LITTLEFS,
+};
+
+// Register LittleFS file system.
+static void register_lfs_filesys() __attribute__((constructor));
+static void register_lfs_filesys() {
+    filesys_type_register(&lfs_filesys);
+}
+
+#endif
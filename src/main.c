@@ -1,6 +1,7 @@
 
 // SPDX-License-Identifier: MIT
 
+#include "arena.h"
 #include "badge_err.h"
 #include "bootprotocol.h"
 #include "checksum.h"
@@ -8,6 +9,7 @@
 #include "memprotect.h"
 #include "port.h"
 #include "port/interrupt.h"
+#include "profile.h"
 #include "time.h"
 
 
@@ -91,8 +93,26 @@ static void register_partitions() {
 
 // Look for a known filesystem.
 static filesys_type_t *find_filesys(partition_t *part) {
+#ifdef ALLOW_UNFORMATTED_PARTITION
+    // Raw images need no probing.
+    if (part->fs_hint == PART_FS_RAW) {
+        return &filesys_type_raw;
+    }
+#endif
+
+    // Try the filesystem the partition system expects first.
+    if (part->fs_hint != PART_FS_UNKNOWN) {
+        for (filesys_type_t *type = filesys_type_first; type; type = type->next) {
+            if (type->hint == part->fs_hint && type->ident(part)) {
+                return type;
+            }
+        }
+    }
+
+    // Then probe all others, skipping the types already tried above.
     for (filesys_type_t *type = filesys_type_first; type; type = type->next) {
-        if (type->ident(part)) {
+        bool tried = part->fs_hint != PART_FS_UNKNOWN && type->hint == part->fs_hint;
+        if (!tried && type->ident(part)) {
             return type;
         }
     }
@@ -119,6 +139,7 @@ static void try_file(file_t *file) {
 // When finished, a kernel is bootstrapped or the bootloader gives up and halts.
 static void bootstrap() {
     logk(LOG_INFO, "KiloBootloader v0.1");
+    logkf(LOG_INFO, "Reached bootstrap %{u32;d} us after entry", port_startup_us());
     logkf(
         LOG_INFO,
         "I know %{size;d} partitioning system%{c}, "
@@ -133,6 +154,14 @@ static void bootstrap() {
     );
 
     // Boot media discovery.
+#ifdef HAS_BOOTMEDIA_SERIAL
+    extern void serialboot_receive();
+    serialboot_receive();
+#endif
+#ifdef HAS_BOOTMEDIA_RAM
+    extern void register_ram_media();
+    register_ram_media();
+#endif
 #ifdef HAS_BOOTMEDIA_XIP
     extern void register_xip_media();
     register_xip_media();
@@ -159,16 +188,26 @@ static void bootstrap() {
 
     // Try to boot the partitions in order.
     for (size_t i = 0; i < partnum; i++) {
+        // Anything a failed attempt allocated is freed before the next partition.
+        ARENA_SCOPE(partition);
         filesys_type_t *type = find_filesys(&parttab[ordertab[i]]);
         if (!type)
             continue;
-        filesys_t filesys;
-        file_t    file;
+        filesys_t filesys = {0};
+        file_t    file    = {0};
         if (!type->read(&parttab[ordertab[i]], &filesys, &file))
             continue;
+#ifdef HAS_FILE_READAHEAD
+        file_readahead_init(&file);
+#endif
         try_file(&file);
+#ifdef HAS_FILE_READAHEAD
+        file_readahead_stats(&file);
+#endif
     }
 
+    arena_stats();
+    PROFILE_SUMMARY();
     logk(LOG_FATAL, "Failed to boot!");
     while (1) continue;
 }
@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: MIT
+
+#ifdef HAS_BOOTMEDIA_BLKDEV
+
+#include "media/blkdev.h"
+
+#include "badge_err.h"
+#include "bootmedia.h"
+#include "log.h"
+#include "meta.h"
+
+
+
+// Block device random read function.
+static diskoff_t bootmedia_blkdev_read(bootmedia_t *media, diskoff_t offset, diskoff_t length, void *_mem) {
+    blkdev_t *dev        = field_parent_ptr(bootmedia_blkdev_t, media, media)->dev;
+    diskoff_t block_size = (diskoff_t)dev->block_size;
+
+    // Bounds checks.
+    if (offset < 0 || length < 0 || offset > media->size) {
+        return -1;
+    }
+    if (offset + length > media->size) {
+        length = media->size - offset;
+    }
+
+    // Memory currently being written to.
+    uint8_t    *mem  = _mem;
+    // Amount read in total.
+    diskoff_t   read = 0;
+    badge_err_t ec;
+
+    while (length > 0) {
+        blksize_t block = offset / block_size;
+        diskoff_t start = offset % block_size;
+
+        if (start || length < block_size) {
+            // Partial block; served from the block device read cache.
+            diskoff_t end = start + length > block_size ? block_size : start + length;
+            blkdev_read_partial(&ec, dev, block, start, mem + read, end - start);
+            if (!badge_err_is_ok(&ec)) {
+                badge_err_log_err(&ec);
+                break;
+            }
+            offset += end - start;
+            length -= end - start;
+            read   += end - start;
+
+        } else {
+            // Run of whole blocks; coalesced into a single device transfer.
+            blksize_t count = length / block_size;
+            blkdev_read_n(&ec, dev, block, count, mem + read);
+            if (!badge_err_is_ok(&ec)) {
+                badge_err_log_err(&ec);
+                break;
+            }
+            offset += (diskoff_t)count * block_size;
+            length -= (diskoff_t)count * block_size;
+            read   += (diskoff_t)count * block_size;
+        }
+    }
+
+    return read;
+}
+
+
+
+// Register a block device as boot media.
+// The block device must already be opened using `blkdev_open`.
+void register_blkdev_media(bootmedia_blkdev_t *media, blkdev_t *dev) {
+    media->dev         = dev;
+    media->media.read  = bootmedia_blkdev_read;
+    media->media.mmap  = NULL;
+    media->media.page  = NULL;
+    media->media.addr  = NULL;
+    media->media.readv = NULL;
+    media->media.size  = (diskoff_t)dev->blocks * (diskoff_t)dev->block_size;
+    bootmedia_register(&media->media);
+    logkf(
+        LOG_INFO,
+        "Block device media: %{u32;d} blocks of %{u32;d} bytes",
+        (uint32_t)dev->blocks,
+        (uint32_t)dev->block_size
+    );
+}
+
+#endif
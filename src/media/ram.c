@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: MIT
+
+#ifdef HAS_BOOTMEDIA_RAM
+
+#include "media/ram.h"
+
+#include "badge_strings.h"
+#include "bootmedia.h"
+#include "log.h"
+#include "memmap.h"
+#include "partsys.h"
+
+// NOLINTBEGIN
+extern char const __start_data[];
+// NOLINTEND
+
+extern ramboot_t ramboot;
+
+
+
+// Base address of the RAM image.
+static size_t ram_base;
+
+// RAM random read function.
+static diskoff_t bootmedia_ram_read(bootmedia_t *media, diskoff_t offset, diskoff_t length, void *mem) {
+    if (offset < 0 || length < 0 || offset > media->size) {
+        return -1;
+    }
+    if (offset + length > media->size) {
+        length = media->size - offset;
+    }
+    if ((size_t)mem != ram_base + offset) {
+        mem_copy(mem, (void const *)(ram_base + offset), length);
+    }
+    return length;
+}
+
+// RAM memory map function.
+// Only identity mappings can be satisfied; the data is already in place.
+static bool bootmedia_ram_mmap(bootmedia_t *media, diskoff_t offset, diskoff_t length, size_t vaddr) {
+    if (offset < 0 || length < 0 || offset + length > media->size) {
+        return false;
+    }
+    if (vaddr != ram_base + offset) {
+        logkf(LOG_ERROR, "Cannot map RAM image offset %{size;x} to %{size;x}", offset, vaddr);
+        return false;
+    }
+    return true;
+}
+
+// RAM direct address function.
+static void const *bootmedia_ram_addr(bootmedia_t *media, diskoff_t offset, diskoff_t length) {
+    if (offset < 0 || length < 0 || offset + length > media->size) {
+        return NULL;
+    }
+    return (void const *)(ram_base + offset);
+}
+
+// RAM boot media.
+static bootmedia_t ram_media = {
+    .read = bootmedia_ram_read,
+    .mmap = bootmedia_ram_mmap,
+    .addr = bootmedia_ram_addr,
+};
+
+
+
+// Try to identify the RAM image.
+static diskoff_t partsys_ram_ident(bootmedia_t *media) {
+    return media == &ram_media;
+}
+
+// Read the RAM image partition entry.
+static partition_t partsys_ram_read(bootmedia_t *media, diskoff_t part_index) {
+    (void)part_index;
+    partition_t part = {
+        .media  = media,
+        .flags  = {.bootable = true},
+        .offset = 0,
+        .length = media->size,
+        .prio   = PART_PRIO_MAX,
+        .name   = "ramboot",
+    };
+    return part;
+}
+
+// RAM image pseudo-partitioning system.
+static partsys_t ram_partsys = {
+    .ident = partsys_ram_ident,
+    .read  = partsys_ram_read,
+};
+
+// Register RAM image pseudo-partitioning system.
+static void register_ram_partsys() __attribute__((constructor));
+static void register_ram_partsys() {
+    partsys_register(&ram_partsys);
+}
+
+
+
+// Register RAM boot media, if the previous stage handed over an image.
+void register_ram_media() {
+    if (ramboot.magic != RAMBOOT_MAGIC) {
+        return;
+    }
+    // Discard the record so a crashing image does not boot again.
+    ramboot.magic = 0;
+
+    size_t addr = ramboot.addr;
+    size_t len  = ramboot.length;
+    if (!len || !IS_SRAM_RANGE(addr, len)) {
+        logkf(LOG_ERROR, "RAM image at %{size;x}-%{size;x} not in SRAM", addr, addr + len - 1);
+        return;
+    }
+    // Above the bootloader's start are its data, the boot arena, ROM data and the stack.
+    if (addr + len > (size_t)__start_data) {
+        logkf(LOG_ERROR, "RAM image at %{size;x}-%{size;x} overlaps bootloader", addr, addr + len - 1);
+        return;
+    }
+
+    ram_base       = addr;
+    ram_media.size = (diskoff_t)len;
+    bootmedia_register(&ram_media);
+    logkf(LOG_INFO, "RAM image at %{size;x}-%{size;x}", addr, addr + len - 1);
+}
+
+#endif
@@ -0,0 +1,247 @@
+// SPDX-License-Identifier: MIT
+
+#ifdef HAS_BOOTMEDIA_SERIAL
+
+#include "media/serial.h"
+
+#include "badge_strings.h"
+#include "log.h"
+#include "media/ram.h"
+#include "memmap.h"
+#include "port.h"
+#include "rawprint.h"
+#include "time.h"
+
+#ifndef HAS_BOOTMEDIA_RAM
+#error "Serial boot media requires RAM boot media"
+#endif
+
+#ifndef SERIALBOOT_WINDOW_SIZE
+// Size of the SRAM receive window, which ends where the bootloader starts.
+// Kernels with SRAM segments in the window cannot be booted over serial.
+#define SERIALBOOT_WINDOW_SIZE 0x40000
+#endif
+#ifndef SERIALBOOT_TIMEOUT_US
+// Time to wait for the host to start a transfer.
+#define SERIALBOOT_TIMEOUT_US 10000000
+#endif
+#ifndef SERIALBOOT_FRAME_TIMEOUT_US
+// Time to wait for the next frame once a transfer was started.
+#define SERIALBOOT_FRAME_TIMEOUT_US 2000000
+#endif
+
+// NOLINTBEGIN
+extern char const __start_data[];
+// NOLINTEND
+
+extern ramboot_t ramboot;
+
+
+
+// Reset a serial boot frame receiver.
+void serialboot_rx_init(serialboot_rx_t *rx) {
+    rx->state   = SERIALBOOT_RX_SYNC0;
+    rx->pos     = 0;
+    rx->dropped = 0;
+}
+
+// Feed one byte into a serial boot frame receiver.
+// Returns true when a complete frame with a valid CRC was received.
+bool serialboot_rx_byte(serialboot_rx_t *rx, uint8_t byte) {
+    switch (rx->state) {
+        case SERIALBOOT_RX_SYNC0:
+            if (byte == SERIALBOOT_SYNC0) {
+                rx->state = SERIALBOOT_RX_SYNC1;
+            }
+            return false;
+
+        case SERIALBOOT_RX_SYNC1:
+            if (byte == SERIALBOOT_SYNC1) {
+                rx->state  = SERIALBOOT_RX_HEADER;
+                rx->pos    = 2;
+                rx->crc    = crc32_init();
+                rx->index  = 0;
+                rx->length = 0;
+            } else if (byte != SERIALBOOT_SYNC0) {
+                rx->state = SERIALBOOT_RX_SYNC0;
+            }
+            return false;
+
+        case SERIALBOOT_RX_HEADER:
+            crc32_byte(&rx->crc, byte);
+            if (rx->pos == 2) {
+                rx->type = byte;
+            } else if (rx->pos >= 4 && rx->pos < 8) {
+                rx->index |= (uint32_t)byte << (8 * (rx->pos - 4));
+            } else if (rx->pos >= 8) {
+                rx->length |= (uint16_t)(byte << (8 * (rx->pos - 8)));
+            }
+            if (++rx->pos < SERIALBOOT_HDR_SIZE) {
+                return false;
+            }
+            if (rx->length > SERIALBOOT_BLOCK_MAX) {
+                rx->dropped++;
+                rx->state = SERIALBOOT_RX_SYNC0;
+                return false;
+            }
+            rx->state  = rx->length ? SERIALBOOT_RX_PAYLOAD : SERIALBOOT_RX_CRC;
+            rx->pos    = 0;
+            rx->rx_crc = 0;
+            return false;
+
+        case SERIALBOOT_RX_PAYLOAD:
+            crc32_byte(&rx->crc, byte);
+            rx->payload[rx->pos] = byte;
+            if (++rx->pos >= rx->length) {
+                rx->state  = SERIALBOOT_RX_CRC;
+                rx->pos    = 0;
+                rx->rx_crc = 0;
+            }
+            return false;
+
+        case SERIALBOOT_RX_CRC:
+            rx->rx_crc |= (uint32_t)byte << (8 * rx->pos);
+            if (++rx->pos < 4) {
+                return false;
+            }
+            rx->state = SERIALBOOT_RX_SYNC0;
+            crc32_final(&rx->crc);
+            if (rx->crc != rx->rx_crc) {
+                rx->dropped++;
+                return false;
+            }
+            return true;
+    }
+    return false;
+}
+
+// Encode a payload-less serial boot frame into `buf`.
+// Returns the frame length.
+size_t serialboot_encode(uint8_t buf[SERIALBOOT_HDR_SIZE + 4], serialboot_type_t type, uint32_t index) {
+    buf[0] = SERIALBOOT_SYNC0;
+    buf[1] = SERIALBOOT_SYNC1;
+    buf[2] = type;
+    buf[3] = 0;
+    for (size_t i = 0; i < 4; i++) {
+        buf[4 + i] = index >> (8 * i);
+    }
+    buf[8] = 0;
+    buf[9] = 0;
+    crc32_t crc = crc32_init();
+    crc32_update(&crc, buf + 2, SERIALBOOT_HDR_SIZE - 2);
+    crc32_final(&crc);
+    for (size_t i = 0; i < 4; i++) {
+        buf[SERIALBOOT_HDR_SIZE + i] = crc >> (8 * i);
+    }
+    return SERIALBOOT_HDR_SIZE + 4;
+}
+
+
+
+// Send a payload-less frame to the host.
+static void serialboot_send(serialboot_type_t type, uint32_t index) {
+    uint8_t buf[SERIALBOOT_HDR_SIZE + 4];
+    size_t  len = serialboot_encode(buf, type, index);
+    for (size_t i = 0; i < len; i++) {
+        rawputc((char)buf[i]);
+    }
+    rawflush();
+}
+
+// Serial boot frame receiver.
+static serialboot_rx_t rx;
+
+// Receive an image over the serial port if requested.
+// On success, the image is handed over to the RAM boot media.
+void serialboot_receive() {
+    if (!port_serialboot_requested()) {
+        return;
+    }
+
+    uint8_t *window    = (uint8_t *)((size_t)__start_data - SERIALBOOT_WINDOW_SIZE);
+    // Total image length.
+    uint32_t image_len = 0;
+    // Next expected block.
+    uint32_t expected  = 0;
+    // A transfer was started.
+    bool     started   = false;
+    // Give up if the host does not start a transfer, or stops sending frames, in time.
+    int64_t  timeout   = time_us() + SERIALBOOT_TIMEOUT_US;
+    logkf(LOG_INFO, "Serial boot: waiting for image at %{size;x}", window);
+
+    serialboot_rx_init(&rx);
+    while (1) {
+        int c = rawgetc();
+        if (c < 0) {
+            if (time_us() > timeout) {
+                logk(LOG_WARN, started ? "Serial boot: host stopped sending" : "Serial boot: timed out");
+                return;
+            }
+            continue;
+        }
+        if (!serialboot_rx_byte(&rx, c)) {
+            continue;
+        }
+        if (started || rx.type == SERIALBOOT_START) {
+            timeout = time_us() + SERIALBOOT_FRAME_TIMEOUT_US;
+        }
+
+        switch (rx.type) {
+            case SERIALBOOT_START:
+                if (rx.length != 4) {
+                    break;
+                }
+                image_len = rx.payload[0] | (rx.payload[1] << 8) | (rx.payload[2] << 16) | (rx.payload[3] << 24);
+                if (!image_len || image_len > SERIALBOOT_WINDOW_SIZE) {
+                    serialboot_send(SERIALBOOT_ERROR, SERIALBOOT_ERR_TOOLARGE);
+                    started = false;
+                    break;
+                }
+                started  = true;
+                expected = 0;
+                serialboot_send(SERIALBOOT_ACK, expected);
+                break;
+
+            case SERIALBOOT_DATA: {
+                if (!started) {
+                    serialboot_send(SERIALBOOT_ERROR, SERIALBOOT_ERR_NOSTART);
+                    break;
+                }
+                // Only accept the next block in order; anything else is answered with the expected block.
+                uint32_t offset = expected * SERIALBOOT_BLOCK_MAX;
+                uint32_t want   = image_len - offset < SERIALBOOT_BLOCK_MAX ? image_len - offset : SERIALBOOT_BLOCK_MAX;
+                if (rx.index == expected && offset < image_len && rx.length == want) {
+                    mem_copy(window + offset, rx.payload, want);
+                    expected++;
+                }
+                serialboot_send(SERIALBOOT_ACK, expected);
+            } break;
+
+            case SERIALBOOT_END:
+                if (!started) {
+                    serialboot_send(SERIALBOOT_ERROR, SERIALBOOT_ERR_NOSTART);
+                    break;
+                }
+                serialboot_send(SERIALBOOT_ACK, expected);
+                if ((uint64_t)expected * SERIALBOOT_BLOCK_MAX < image_len) {
+                    break;
+                }
+                logkf(
+                    LOG_INFO,
+                    "Serial boot: received %{u32;d} bytes (%{u32;d} bad frames)",
+                    image_len,
+                    rx.dropped
+                );
+                ramboot.magic  = RAMBOOT_MAGIC;
+                ramboot.addr   = (size_t)window;
+                ramboot.length = image_len;
+                return;
+
+            case SERIALBOOT_ABORT: logk(LOG_INFO, "Serial boot: aborted by host"); return;
+
+            default: break;
+        }
+    }
+}
+
+#endif
@@ -11,31 +11,29 @@
 
 
 
-// XIP random read function.
-static diskoff_t bootmedia_xip_read(bootmedia_t *media, diskoff_t offset, diskoff_t length, void *_mem) {
-    (void)media;
+// Copy from XIP through the temporary page at `vaddr`, remapping it only when another ROM page is needed.
+// `*page` holds the ROM address currently mapped there, or SIZE_MAX if none.
+static diskoff_t xip_copy(size_t vaddr, size_t *page, diskoff_t offset, diskoff_t length, uint8_t *mem) {
     size_t page_size = xip_get_page_size();
-
-    // Memory currently being written to.
-    uint8_t *mem  = _mem;
     // Amount read in total.
-    size_t   read = 0;
+    size_t read      = 0;
 
     while (length > 0) {
-        // Get a temporary page to map to.
-        xip_range_t range = {
-            .rom_addr = offset - offset % page_size,
-            .map_addr = xip_find_vaddr(),
-            .length   = xip_get_page_size(),
-            .enable   = true,
-        };
-        if (!range.map_addr) {
-            logk(LOG_ERROR, "Out of XIP to map for reading");
-            break;
-        }
-        if (!xip_map(range, true)) {
-            logk(LOG_ERROR, "Unable to map XIP for reading");
-            break;
+        // Map the page holding `offset`, if it is not mapped already.
+        size_t rom_addr = offset - offset % page_size;
+        if (rom_addr != *page) {
+            xip_range_t range = {
+                .rom_addr = rom_addr,
+                .map_addr = vaddr,
+                .length   = page_size,
+                .enable   = true,
+            };
+            if (!xip_map(range, true)) {
+                logk(LOG_ERROR, "Unable to map XIP for reading");
+                *page = SIZE_MAX;
+                break;
+            }
+            *page = rom_addr;
         }
 
         // Page read start address.
@@ -43,10 +41,7 @@ static diskoff_t bootmedia_xip_read(bootmedia_t *media, diskoff_t offset, diskof
         // Page read end address.
         size_t end   = start + length > page_size ? page_size : start + length;
         // Copy from the memory-mapped page.
-        mem_copy(mem + read, (void const *)(range.map_addr + start), end - start);
-
-        // Unmap the temporary page.
-        xip_unmap(range.map_addr, 1);
+        mem_copy(mem + read, (void const *)(vaddr + start), end - start);
 
         // Move on to the next page.
         offset += end - start;
@@ -57,6 +52,45 @@ static diskoff_t bootmedia_xip_read(bootmedia_t *media, diskoff_t offset, diskof
     return read;
 }
 
+// XIP random read function.
+static diskoff_t bootmedia_xip_read(bootmedia_t *media, diskoff_t offset, diskoff_t length, void *mem) {
+    (void)media;
+
+    // Get a temporary page to map to.
+    size_t vaddr = xip_find_vaddr();
+    if (!vaddr) {
+        logk(LOG_ERROR, "Out of XIP to map for reading");
+        return 0;
+    }
+
+    size_t    page = SIZE_MAX;
+    diskoff_t read = xip_copy(vaddr, &page, offset, length, mem);
+    xip_unmap(vaddr, 1);
+    return read;
+}
+
+// XIP vectored read function.
+// The requests are sorted so that each ROM page is mapped at most once.
+static diskoff_t bootmedia_xip_readv(bootmedia_t *media, bootmedia_iov_t *iov, size_t count) {
+    (void)media;
+    bootmedia_iov_sort(iov, count);
+
+    // Get a temporary page to map to.
+    size_t vaddr = xip_find_vaddr();
+    if (!vaddr) {
+        logk(LOG_ERROR, "Out of XIP to map for reading");
+        return 0;
+    }
+
+    size_t    page  = SIZE_MAX;
+    diskoff_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += xip_copy(vaddr, &page, iov[i].offset, iov[i].length, iov[i].mem);
+    }
+    xip_unmap(vaddr, 1);
+    return total;
+}
+
 // XIP memory map function.
 static bool bootmedia_xip_mmap(bootmedia_t *media, diskoff_t offset, diskoff_t length, size_t vaddr) {
     (void)media;
@@ -90,9 +124,10 @@ diskoff_t bootmedia_xip_page(bootmedia_t *media, diskoff_t *page_size) {
 
 // XIP boot media.
 static bootmedia_t xip_media = {
-    .read = bootmedia_xip_read,
-    .mmap = bootmedia_xip_mmap,
-    .page = bootmedia_xip_page,
+    .read  = bootmedia_xip_read,
+    .mmap  = bootmedia_xip_mmap,
+    .page  = bootmedia_xip_page,
+    .readv = bootmedia_xip_readv,
 };
 
 // Register XIP boot media.
@@ -185,6 +185,32 @@ static partition_t partsys_esp_read(bootmedia_t *media, diskoff_t part_index) {
     part.name[name_len] = 0;
     part.flags.bootable = entry.type == PART_TYPE_APP || entry.type == PART_TYPE_APPFS;
     part.prio           = PART_PRIO_DEFAULT - 10 * (entry.type == PART_TYPE_APPFS);
+#ifdef HAS_FILESYS_FAT
+    if (entry.type == PART_TYPE_DATA && entry.subtype == PART_SUBTYPE_DATA_FATFS) {
+        // User storage is only tried after every app partition.
+        part.flags.bootable = true;
+        part.prio           = PART_PRIO_DEFAULT + 10;
+    }
+#endif
+#ifdef HAS_FILESYS_LITTLEFS
+    if (entry.type == PART_TYPE_DATA && entry.subtype == PART_SUBTYPE_DATA_LITTLEFS) {
+        // User storage is only tried after every app partition.
+        part.flags.bootable = true;
+        part.prio           = PART_PRIO_DEFAULT + 10;
+    }
+#endif
+
+    // Tell the filesystem search what to expect.
+    part.fs_hint = PART_FS_UNKNOWN;
+    if (entry.type == PART_TYPE_APP) {
+        part.fs_hint = PART_FS_RAW;
+    } else if (entry.type == PART_TYPE_APPFS && entry.subtype == PART_SUBTYPE_APPFS) {
+        part.fs_hint = PART_FS_APPFS;
+    } else if (entry.type == PART_TYPE_DATA && entry.subtype == PART_SUBTYPE_DATA_FATFS) {
+        part.fs_hint = PART_FS_FAT;
+    } else if (entry.type == PART_TYPE_DATA && entry.subtype == PART_SUBTYPE_DATA_LITTLEFS) {
+        part.fs_hint = PART_FS_LITTLEFS;
+    }
 
     return part;
 }
@@ -0,0 +1,171 @@
+// SPDX-License-Identifier: MIT
+
+#ifdef HAS_PROFILE
+
+#include "profile.h"
+
+#include "cpu/counters.h"
+#include "log.h"
+
+// Width of the longest histogram bar.
+#define PROFILE_BAR_WIDTH 40
+
+#ifdef HAS_PROFILE_FUNCS
+// Maximum number of distinct functions recorded.
+#define PROFILE_FUNCS_MAX  1024
+// Number of slots in the recorded function set; a power of two larger than `PROFILE_FUNCS_MAX`.
+#define PROFILE_FUNCS_HASH 2048
+#endif
+
+
+
+// Registered regions.
+static profile_region_t *regions;
+// Whether measuring is paused, so the summary does not measure itself.
+static bool              paused;
+
+#ifdef HAS_PROFILE_FUNCS
+// Set of functions entered, by address.
+static void  *funcs_seen[PROFILE_FUNCS_HASH];
+// Functions entered, in order of first entry.
+static void  *funcs[PROFILE_FUNCS_MAX];
+// Number of functions entered.
+static size_t funcs_len;
+
+// Record the first entry of each function; called by `-finstrument-functions` code.
+__attribute__((no_instrument_function)) void __cyg_profile_func_enter(void *func, void *call_site) {
+    (void)call_site;
+    if (paused) {
+        return;
+    }
+    size_t slot = ((size_t)func >> 1) * 2654435761u % PROFILE_FUNCS_HASH;
+    while (funcs_seen[slot]) {
+        if (funcs_seen[slot] == func) {
+            return;
+        }
+        slot = (slot + 1) % PROFILE_FUNCS_HASH;
+    }
+    if (funcs_len < PROFILE_FUNCS_MAX) {
+        funcs_seen[slot]   = func;
+        funcs[funcs_len++] = func;
+    }
+}
+
+// Called by `-finstrument-functions` code on function exit.
+__attribute__((no_instrument_function)) void __cyg_profile_func_exit(void *func, void *call_site) {
+    (void)func;
+    (void)call_site;
+}
+#endif
+
+// Index of the highest set bit, or 0 for 0.
+static inline int profile_log2(uint32_t value) {
+    int log = 0;
+    for (int shift = 16; shift; shift /= 2) {
+        if (value >> shift) {
+            value >>= shift;
+            log    += shift;
+        }
+    }
+    return log;
+}
+
+// Start measuring a region.
+profile_scope_t profile_enter(profile_region_t *region) {
+    if (paused) {
+        return (profile_scope_t){0};
+    }
+    if (!region->registered) {
+        region->registered = true;
+        region->min        = UINT32_MAX;
+        region->next       = regions;
+        regions            = region;
+    }
+    return (profile_scope_t){
+        .region  = region,
+        .instret = cpu_instret(),
+        .cycles  = cpu_cycles(),
+    };
+}
+
+// Stop measuring a region and add the measurement to its statistics.
+void profile_exit(profile_scope_t *scope) {
+    uint32_t cycles = cpu_cycles() - scope->cycles;
+    if (!scope->region) {
+        return;
+    }
+    profile_region_t *region  = scope->region;
+    uint32_t          instret = cpu_instret() - scope->instret;
+    region->calls++;
+    region->cycles  += cycles;
+    region->instret += instret;
+    if (cycles < region->min) {
+        region->min = cycles;
+    }
+    if (cycles > region->max) {
+        region->max = cycles;
+    }
+    region->hist[profile_log2(cycles)]++;
+}
+
+// Print the histogram of one region.
+static void profile_histogram(profile_region_t *region) {
+    uint32_t peak = 0;
+    for (int i = 0; i < PROFILE_BUCKETS; i++) {
+        if (region->hist[i] > peak) {
+            peak = region->hist[i];
+        }
+    }
+
+    char bar[PROFILE_BAR_WIDTH + 1];
+    for (int i = 0; i < PROFILE_BUCKETS; i++) {
+        if (!region->hist[i]) {
+            continue;
+        }
+        // Non-empty buckets get at least one mark.
+        size_t len = (uint64_t)region->hist[i] * PROFILE_BAR_WIDTH / peak;
+        if (!len) {
+            len = 1;
+        }
+        for (size_t x = 0; x < len; x++) {
+            bar[x] = '#';
+        }
+        bar[len] = 0;
+        logkf(LOG_INFO, "  >= 2^%{d} %{u32;d} %{cs}", i, region->hist[i], bar);
+    }
+}
+
+// Print the statistics and histograms of all regions that were entered.
+void profile_summary() {
+    paused = true;
+    logk(LOG_INFO, "Profile summary (cycles per call):");
+    for (profile_region_t *region = regions; region; region = region->next) {
+        if (!region->calls) {
+            continue;
+        }
+        logkf(
+            LOG_INFO,
+            "%{cs}: %{u32;d} calls, %{u64;d} cycles, min %{u32;d}, avg %{u64;d}, max %{u32;d}",
+            region->name,
+            region->calls,
+            region->cycles,
+            region->min,
+            region->cycles / region->calls,
+            region->max
+        );
+        if (region->instret) {
+            logkf(LOG_INFO, "  %{u64;d} instructions retired", region->instret);
+        }
+        profile_histogram(region);
+    }
+#ifdef HAS_PROFILE_FUNCS
+    // Parsed by tools/link-order.py to generate the linker function order.
+    logkf(LOG_INFO, "%{size;d} functions entered during boot:", funcs_len);
+    for (size_t i = 0; i < funcs_len; i++) {
+        logkf(LOG_INFO, "Boot function 0x%{size;x}", (size_t)funcs[i]);
+    }
+#endif
+    paused = false;
+}
+
+#endif
@@ -3,11 +3,26 @@
 
 #ifdef HAS_BOOTPROTOCOL_ESP
 
+#include "arena.h"
 #include "attributes.h"
+#include "badge_strings.h"
 #include "bootprotocol.h"
+#include "cpu/trampoline.h"
 #include "log.h"
 #include "memmap.h"
 #include "port.h"
+#include "profile.h"
+
+#ifdef HAS_ESP_PRELOAD
+#include "port/esp_cache.h"
+#endif
+
+#ifdef ESP_SIGNED_BOOT
+#include "dma.h"
+#include "ed25519.h"
+#include "hash.h"
+#include "time.h"
+#endif
 
 
 
@@ -17,6 +32,26 @@
 
 #define ESP_MAX_SEG 16
 
+// Alignment of XIP segments relative to their image offset.
+#define ESP_XIP_ALIGN 0x10000
+
+#ifdef ESP_SIGNED_BOOT
+// Size of the chunks in which SRAM segments are loaded and hashed.
+#define ESP_LOAD_CHUNK 4096
+#endif
+
+// Signature block magic ("KBSG").
+#define ESP_SIG_MAGIC     0x4753424b
+// Signature block length: magic and Ed25519 signature.
+#define ESP_SIG_BLOCK_LEN 68
+
+#ifdef HAS_ESP_PRELOAD
+// Hot range block magic ("KBHR").
+#define ESP_HOT_MAGIC 0x5248424b
+// Maximum number of hot ranges used from an image.
+#define ESP_HOT_MAX   7
+#endif
+
 // ESP boot protocol header.
 typedef struct PACKED {
     // Magic byte.
@@ -55,12 +90,291 @@ typedef struct {
     uint32_t length;
 } esp_boot_seg_t;
 
+#ifdef ESP_SIGNED_BOOT
+// Signature block appended to signed images by tools/sign-image.py.
+typedef struct PACKED {
+    // Magic value.
+    uint32_t magic;
+    // Ed25519 signature over the SHA-256 of the image.
+    uint8_t  signature[ED25519_SIGNATURE_LEN];
+} esp_sig_block_t;
+#endif
 
 
+
+#ifdef HAS_ESP_PRELOAD
+// Hot range block appended to images by tools/hot-ranges.py.
+typedef struct {
+    // Magic value.
+    uint32_t       magic;
+    // Number of ranges.
+    uint32_t       count;
+    // Ranges of kernel code to preload, in order of use.
+    esp_boot_seg_t ranges[ESP_HOT_MAX];
+} esp_hot_block_t;
+#endif
+
+
+
+// NOLINTBEGIN
+extern char const __start_data[];
+// NOLINTEND
+
 // ESP segments.
-esp_boot_seg_t segs[ESP_MAX_SEG];
+esp_boot_seg_t    segs[ESP_MAX_SEG];
 // ESP segment physical addresses.
-uint32_t       segs_paddr[ESP_MAX_SEG];
+uint32_t          segs_paddr[ESP_MAX_SEG];
+// Source of the part of each SRAM segment that is copied by the trampoline, or NULL if none.
+static void const *segs_tail[ESP_MAX_SEG];
+// Copies left to the trampoline for SRAM that the bootloader occupies.
+static trampoline_copy_t tail_copies[ESP_MAX_SEG];
+// Number of copies left to the trampoline.
+static size_t            tail_copies_num;
+// Lowest XIP address used to map trampoline sources.
+static size_t            tail_xip_low;
+
+#ifdef ESP_SIGNED_BOOT
+#ifdef ESP_SIGNED_BOOT_KEY
+// Public key used to verify images.
+static uint8_t const esp_pubkey[ED25519_PUBKEY_LEN] = {ESP_SIGNED_BOOT_KEY};
+#endif
+// Buffer used to hash the parts of the image that are not loaded into SRAM.
+static uint8_t       hash_buf[512];
+// Hash of the image, fed while the image is loaded.
+static hash_t        image_hash;
+
+// Add `len` bytes of the image at `off` to the image hash.
+static bool esp_hash_file(file_t *file, diskoff_t off, diskoff_t len) {
+    while (len) {
+        diskoff_t chunk = len < (diskoff_t)sizeof(hash_buf) ? len : (diskoff_t)sizeof(hash_buf);
+        if (file->read(file, off, chunk, hash_buf) != chunk) {
+            logk(LOG_ERROR, "Too few bytes read from media (image)");
+            return false;
+        }
+        hash_update(&image_hash, hash_buf, chunk);
+        off += chunk;
+        len -= chunk;
+    }
+    return true;
+}
+
+// Verify the signature block of an image of `image_len` bytes with SHA-256 `digest`.
+static bool esp_verify_signature(
+    file_t *file, esp_boot_hdr_t const *header, diskoff_t image_len, uint8_t const digest[SHA256_DIGEST_LEN]
+) {
+    // An appended SHA256 is the same digest, so check it too.
+    diskoff_t sig_off = image_len;
+    if (header->has_sha256) {
+        uint8_t appended[SHA256_DIGEST_LEN];
+        if (file->read(file, sig_off, sizeof(appended), appended) != sizeof(appended)) {
+            logk(LOG_ERROR, "Too few bytes read from media (SHA256)");
+            return false;
+        }
+        if (!mem_equals(appended, digest, SHA256_DIGEST_LEN)) {
+            logk(LOG_ERROR, "Appended SHA256 mismatch");
+            return false;
+        }
+        sig_off += SHA256_DIGEST_LEN;
+    }
+
+    esp_sig_block_t sig;
+    if (file->read(file, sig_off, sizeof(sig), &sig) != sizeof(sig) || sig.magic != ESP_SIG_MAGIC) {
+        logk(LOG_ERROR, "Image is not signed");
+        return false;
+    }
+
+#ifdef ESP_SIGNED_BOOT_KEY
+    uint8_t const *pubkey = esp_pubkey;
+#else
+    uint8_t efuse_key[ED25519_PUBKEY_LEN];
+    uint8_t efuse_or = 0;
+    if (port_efuse_read_key(ESP_SIGNED_BOOT_EFUSE, efuse_key)) {
+        for (size_t i = 0; i < sizeof(efuse_key); i++) {
+            efuse_or |= efuse_key[i];
+        }
+    }
+    // An all-zero key is a valid curve point of small order, which would accept forgeries.
+    if (!efuse_or) {
+        logkf(LOG_ERROR, "eFuse key block %{d} holds no public key", ESP_SIGNED_BOOT_EFUSE);
+        return false;
+    }
+    uint8_t const *pubkey = efuse_key;
+#endif
+
+    uint32_t start = time_cycles();
+    bool     valid = ed25519_verify(sig.signature, pubkey, digest, SHA256_DIGEST_LEN);
+    uint32_t took  = time_cycles() - start;
+    if (!valid) {
+        logk(LOG_ERROR, "Image signature invalid");
+        return false;
+    }
+    logkf(LOG_INFO, "Image signature verified in %{u32;d} us (%{u32;d} cycles)", took / ESP_CLOCK_FREQ_MHZ, took);
+    return true;
+}
+#endif
+
+#ifdef ESP_SIGNED_BOOT
+// Add a loaded chunk to the image hash.
+static void esp_hash_chunk(void *cookie, void const *mem, size_t len) {
+    (void)cookie;
+    hash_update(&image_hash, mem, len);
+}
+#endif
+
+// Load a segment into SRAM.
+static void esp_load_sram(file_t *file, diskoff_t off, diskoff_t len, uint8_t *dest) {
+#ifdef ESP_SIGNED_BOOT
+    // Media that are plain memory are copied by DMA, which fetches the next chunk while the CPU hashes this one.
+    void const *src = file->addr ? file->addr(file, off, len) : NULL;
+    if (src) {
+        dma_copy_chunked(dest, src, len, ESP_LOAD_CHUNK, esp_hash_chunk, NULL);
+        return;
+    }
+
+    // Otherwise each chunk is hashed from SRAM right after it is read, which leaves the hash engine
+    // working on its last block while the next chunk is read from the media.
+    while (len) {
+        diskoff_t chunk = len < ESP_LOAD_CHUNK ? len : ESP_LOAD_CHUNK;
+        file->read(file, off, chunk, dest);
+        hash_update(&image_hash, dest, chunk);
+        off  += chunk;
+        dest += chunk;
+        len  -= chunk;
+    }
+#else
+    file->read(file, off, len, dest);
+#endif
+}
+
+#ifdef HAS_ESP_PRELOAD
+// Queue an instruction cache preload for the parts of a range that lie in XIP segments.
+static void esp_preload_range(esp_boot_hdr_t const *header, size_t addr, size_t len) {
+    for (size_t i = 0; i < header->segments; i++) {
+        if (!IS_XIP_RANGE(segs[i].vaddr, segs[i].length)) {
+            continue;
+        }
+        size_t seg_end = segs[i].vaddr + segs[i].length;
+        if (addr >= seg_end) {
+            continue;
+        }
+        size_t start = addr > segs[i].vaddr ? addr : segs[i].vaddr;
+        size_t end   = len < seg_end - addr ? addr + len : seg_end;
+        if (start < end) {
+            esp_cache_preload(start, end - start);
+        }
+    }
+}
+
+// Start preloading the kernel entry window and the hot ranges listed after the image ending at `image_len`.
+static void esp_preload_kernel(file_t *file, esp_boot_hdr_t const *header, diskoff_t image_len) {
+    // Media reads may remap XIP pages, so the hot ranges are read before any preload starts.
+    esp_hot_block_t hot;
+    diskoff_t       hot_off = image_len + (header->has_sha256 ? 32 : 0);
+    uint32_t        magic   = 0;
+    if (file->read(file, hot_off, sizeof(magic), &magic) == sizeof(magic) && magic == ESP_SIG_MAGIC) {
+        hot_off += ESP_SIG_BLOCK_LEN;
+    }
+    diskoff_t got    = file->read(file, hot_off, sizeof(hot), &hot);
+    uint32_t  usable = got < 8 ? 0 : (got - 8) / sizeof(esp_boot_seg_t);
+    if (!usable || hot.magic != ESP_HOT_MAGIC) {
+        hot.count = 0;
+    } else if (hot.count > usable) {
+        logkf(LOG_WARN, "Image lists %{u32;d} hot ranges, using the first %{u32;d}", hot.count, usable);
+        hot.count = usable;
+    }
+
+    // Code mostly runs forward from the entry point, so most of the window lies after it.
+    size_t window = ESP_PRELOAD_WINDOW;
+    size_t before = header->entry > window / 4 ? window / 4 : header->entry;
+    esp_preload_range(header, header->entry - before, window);
+    for (uint32_t i = 0; i < hot.count; i++) {
+        esp_preload_range(header, hot.ranges[i].vaddr, hot.ranges[i].length);
+    }
+    logkf(LOG_DEBUG, "Preloading kernel code: entry window and %{u32;d} hot ranges", hot.count);
+}
+#endif
+
+// Find XIP address space for `len` bytes at image offset `off` that overlaps no XIP segment.
+// Returns 0 if there is none.
+static size_t esp_tail_xip_window(esp_boot_hdr_t const *header, diskoff_t off, size_t len) {
+    size_t sub  = off % ESP_XIP_ALIGN;
+    size_t span = (sub + len + ESP_XIP_ALIGN - 1) & ~(ESP_XIP_ALIGN - 1);
+    size_t top  = tail_xip_low;
+    for (size_t i = 0; i < header->segments;) {
+        if (top - (size_t)__start_xip < span) {
+            return 0;
+        }
+        size_t start = top - span;
+        if (IS_XIP_RANGE(segs[i].vaddr, segs[i].length) && segs[i].vaddr < top &&
+            segs[i].vaddr + segs[i].length > start) {
+            // Move below this segment and check all of them again.
+            top = segs[i].vaddr & ~(ESP_XIP_ALIGN - 1);
+            i   = 0;
+            continue;
+        }
+        i++;
+    }
+    tail_xip_low = top - span;
+    return top - span + sub;
+}
+
+// Whether `len` bytes at `addr` overlap SRAM that any segment is loaded to, either directly or by the trampoline.
+static bool esp_overlaps_sram(esp_boot_hdr_t const *header, size_t addr, size_t len) {
+    for (size_t i = 0; i < header->segments; i++) {
+        if (IS_SRAM_RANGE(segs[i].vaddr, segs[i].length) && addr < segs[i].vaddr + segs[i].length &&
+            addr + len > segs[i].vaddr) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Prepare the part of SRAM segment `index` from byte `head` on, which overlaps the bootloader, for the trampoline.
+// Its source has to stay addressable until handover: media that are plain memory are used in place,
+// others are memory-mapped into XIP that the kernel does not use.
+static bool esp_defer_sram(file_t *file, esp_boot_hdr_t const *header, size_t index, size_t head) {
+    diskoff_t   off = segs_paddr[index] + head;
+    size_t      len = segs[index].length - head;
+    void const *src = file->addr ? file->addr(file, off, len) : NULL;
+    if (src && esp_overlaps_sram(header, (size_t)src, len)) {
+        // Loading another segment, or the trampoline, could overwrite this before it is copied.
+        logkf(LOG_WARN, "Image data at %{size;x} lies under the kernel, not using it in place", (size_t)src);
+        src = NULL;
+    }
+    if (!src && file->mmap) {
+        size_t vaddr = esp_tail_xip_window(header, off, len);
+        if (vaddr && file->mmap(file, off, len, vaddr)) {
+            src = (void const *)vaddr;
+        }
+    }
+    if (!src) {
+        logkf(
+            LOG_ERROR,
+            "Unable to load %{size;x}-%{size;x} over the bootloader from this media",
+            segs[index].vaddr + head,
+            segs[index].vaddr + segs[index].length - 1
+        );
+        return false;
+    }
+
+#ifdef ESP_SIGNED_BOOT
+    hash_update(&image_hash, src, len);
+#endif
+    segs_tail[index]               = src;
+    tail_copies[tail_copies_num++] = (trampoline_copy_t){segs[index].vaddr + head, (size_t)src, len};
+    return true;
+}
+
+// Number of bytes at the start of an SRAM segment that lie below the bootloader.
+static size_t esp_sram_head(esp_boot_seg_t const *seg) {
+    size_t limit = (size_t)__start_data;
+    if (seg->vaddr >= limit) {
+        return 0;
+    } else if (seg->vaddr + seg->length > limit) {
+        return limit - seg->vaddr;
+    }
+    return seg->length;
+}
 
 // ESP identify function.
 static bool bootprotocol_esp_ident(file_t *file) {
@@ -92,9 +406,11 @@ static bool bootprotocol_esp_boot(file_t *file) {
         logkf(LOG_ERROR, "Invalid ESP segment count (%{u8;d})", header.segments);
         return false;
     }
+#ifndef ESP_SIGNED_BOOT
     if (header.has_sha256) {
         logk(LOG_WARN, "ESP image has SHA256 appended, ignoring");
     }
+#endif
 
     // Lowest common denominator for page size.
     diskoff_t page_size = (DISKOFF_MAX >> 1) + 1;
@@ -140,15 +456,53 @@ static bool bootprotocol_esp_boot(file_t *file) {
         logkf(LOG_INFO, "Using page size %{" FMT_TYPE_DISKOFF ";d}", page_size);
     }
 
+    // Images in plain memory, such as those received over serial, are read in place while the segments are loaded.
+    void const *image = file->addr ? file->addr(file, 0, file->size) : NULL;
+    if (image && esp_overlaps_sram(&header, (size_t)image, file->size)) {
+        logkf(
+            LOG_ERROR,
+            "Image at %{size;x}-%{size;x} overlaps SRAM the kernel loads to",
+            (size_t)image,
+            (size_t)image + (size_t)file->size - 1
+        );
+        return false;
+    }
+
     // Map segments.
     logkf(LOG_INFO, "Loading kernel");
+    tail_copies_num = 0;
+    tail_xip_low    = (size_t)__stop_xip;
+#ifdef ESP_SIGNED_BOOT
+    // The image is hashed in file order while it is loaded; nothing loaded runs before the signature checks out.
+    hash_init(&image_hash);
+    hash_update(&image_hash, &header, sizeof(header));
+#endif
     for (size_t i = 0; i < header.segments; i++) {
+        segs_tail[i] = NULL;
+#ifdef ESP_SIGNED_BOOT
+        hash_update(&image_hash, &segs[i], sizeof(esp_boot_seg_t));
+#endif
         if (IS_XIP_RANGE(segs[i].vaddr, segs[i].length)) {
             // Try to memory map this.
             file->mmap(file, segs_paddr[i], segs[i].length, segs[i].vaddr);
+#ifdef ESP_SIGNED_BOOT
+            if (!esp_hash_file(file, segs_paddr[i], segs[i].length)) {
+                hash_abort(&image_hash);
+                return false;
+            }
+#endif
         } else if (IS_SRAM_RANGE(segs[i].vaddr, segs[i].length)) {
-            // Try to read this.
-            file->read(file, segs_paddr[i], segs[i].length, (void *)segs[i].vaddr);
+            // Try to read this; SRAM the bootloader occupies is filled in by the trampoline.
+            size_t head = esp_sram_head(&segs[i]);
+            if (head) {
+                esp_load_sram(file, segs_paddr[i], head, (uint8_t *)segs[i].vaddr);
+            }
+            if (head < segs[i].length && !esp_defer_sram(file, &header, i, head)) {
+#ifdef ESP_SIGNED_BOOT
+                hash_abort(&image_hash);
+#endif
+                return false;
+            }
         } else {
             // Not loadable to this address.
             logkf(
@@ -157,10 +511,25 @@ static bool bootprotocol_esp_boot(file_t *file) {
                 segs[i].vaddr,
                 segs[i].vaddr + segs[i].length
             );
+#ifdef ESP_SIGNED_BOOT
+            hash_abort(&image_hash);
+#endif
             return false;
         }
     }
 
+#ifdef ESP_SIGNED_BOOT
+    // The signed digest covers the image up to and including the checksum byte.
+    diskoff_t image_len = (seg_off | 15) + 1;
+    uint8_t   digest[SHA256_DIGEST_LEN];
+    bool      hashed = esp_hash_file(file, seg_off, image_len - seg_off);
+    hash_final(&image_hash, digest);
+    logkf(LOG_DEBUG, "Image hashed by %{cs} engine", image_hash.engine->name);
+    if (!hashed || !esp_verify_signature(file, &header, image_len, digest)) {
+        return false;
+    }
+#endif
+
     // Read checksum.
     diskoff_t xsum_off   = seg_off;
     diskoff_t padd_size  = ((xsum_off + 15) & ~15) - xsum_off;
@@ -176,10 +545,15 @@ static bool bootprotocol_esp_boot(file_t *file) {
     // Take checksum of loaded segments.
     uint8_t xsum_state = 0xEF;
     for (size_t i = 0; i < header.segments; i++) {
-        uint8_t const *ptr = (uint8_t const *)segs[i].vaddr;
-        for (size_t x = 0; x < segs[i].length; x++) {
+        uint8_t const *ptr  = (uint8_t const *)segs[i].vaddr;
+        size_t         head = segs_tail[i] ? esp_sram_head(&segs[i]) : segs[i].length;
+        for (size_t x = 0; x < head; x++) {
             xsum_state ^= ptr[x];
         }
+        ptr = segs_tail[i];
+        for (size_t x = head; x < segs[i].length; x++) {
+            xsum_state ^= ptr[x - head];
+        }
     }
 
     // Compare checksums.
@@ -188,10 +562,31 @@ static bool bootprotocol_esp_boot(file_t *file) {
         return false;
     }
 
+#ifdef HAS_ESP_PRELOAD
+    // Warm the instruction cache for the kernel while the handover is prepared.
+    esp_preload_kernel(file, &header, xsum_off + 1);
+#endif
+
     // Hand over control.
+#ifdef HAS_FILE_READAHEAD
+    file_readahead_stats(file);
+#endif
+    arena_stats();
+    PROFILE_SUMMARY();
     logkf(LOG_INFO, "Jumping to 0x%{size;x}", header.entry);
-    if (!port_pre_handover())
+    bool ready = port_pre_handover();
+#ifdef HAS_ESP_PRELOAD
+    // The preload also finishes if the handover is aborted, as the XIP map may change again.
+    esp_cache_preload_wait();
+#endif
+    if (!ready)
         return false;
+    // The arena is only overwritten by the trampoline; nothing may use it from here on.
+    arena_release();
+    if (tail_copies_num) {
+        // Nothing may run from the bootloader's SRAM once the trampoline starts copying over it.
+        trampoline_run(__start_trampoline, tail_copies, tail_copies_num, header.entry);
+    }
     ((void (*)())header.entry)();
 
     return true;
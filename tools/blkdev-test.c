@@ -0,0 +1,162 @@
+// SPDX-License-Identifier: MIT
+
+// Host test for the block device layer and the block device boot media adapter.
+// Build from the repository root with:
+//   cc -O2 -DHAS_BOOTMEDIA_BLKDEV -Iinclude -Iinclude/badgelib -o blkdev-test tools/blkdev-test.c
+// Random reads through the boot media are checked against the device contents, and the number of device
+// transfers is counted to check that whole blocks are coalesced and cached blocks are not read again.
+
+#include "badge_err.h"
+
+// The bootloader's error setter reads the PC with RISC-V assembly.
+#undef badge_err_set
+#define badge_err_set(ec, location_value, cause_value)                                                                 \
+    do {                                                                                                               \
+        if ((ec) != NULL) {                                                                                            \
+            (ec)->location = location_value;                                                                           \
+            (ec)->cause    = cause_value;                                                                              \
+        }                                                                                                              \
+    } while (false)
+
+#include "../src/blockdevice.c"
+#include "../src/media/blkdev.c"
+
+// Included after the sources; glibc's <stdlib.h> has a conflicting `blksize_t`.
+#include <stdio.h>
+#include <string.h>
+
+// Block size of the test device.
+#define BLOCK_SIZE  512
+// Number of blocks of the test device.
+#define BLOCK_COUNT 64
+// Number of read cache entries.
+#define CACHE_DEPTH 4
+
+// Device contents.
+static uint8_t        disk[BLOCK_SIZE * BLOCK_COUNT];
+// Read cache.
+static uint8_t        cache_data[BLOCK_SIZE * CACHE_DEPTH];
+static blkdev_flags_t cache_flags[CACHE_DEPTH];
+static blkdev_cache_t cache = {cache_data, cache_flags, CACHE_DEPTH};
+// Number of copies from the device contents.
+static int            transfers;
+// Fake microsecond clock.
+static timestamp_us_t now;
+// Number of failed checks.
+static int            failures;
+// Random number state.
+static uint32_t       seed = 1;
+
+static int rand() {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 1;
+}
+
+void mem_copy(void *dest, void const *src, size_t size) {
+    if ((uint8_t const *)src >= disk && (uint8_t const *)src < disk + sizeof(disk)) {
+        transfers++;
+    }
+    memmove(dest, src, size);
+}
+
+timestamp_us_t time_us() {
+    return now++;
+}
+
+void logk(log_level_t level, char const *msg) {
+    (void)level;
+    printf("%s\n", msg);
+}
+
+void logkf(log_level_t level, char const *msg, ...) {
+    (void)level;
+    (void)msg;
+}
+
+char const *badge_eloc_get_name(badge_eloc_t eloc) {
+    (void)eloc;
+    return "";
+}
+
+char const *badge_ecause_get_name(badge_ecause_t cause) {
+    (void)cause;
+    return "";
+}
+
+void bootmedia_register(bootmedia_t *media) {
+    (void)media;
+}
+
+static void expect(char const *what, bool ok) {
+    if (!ok && failures++ < 10) {
+        printf("FAIL %s\n", what);
+    }
+}
+
+int main() {
+    for (size_t i = 0; i < sizeof(disk); i++) {
+        disk[i] = rand();
+    }
+    blkdev_t dev = {
+        .type         = BLKDEV_TYPE_RAM,
+        .block_size   = BLOCK_SIZE,
+        .block_offset = 2,
+        .blocks       = BLOCK_COUNT - 2,
+        .ram_addr     = disk,
+        .cache_read   = true,
+        .cache        = &cache,
+    };
+    badge_err_t ec;
+    blkdev_open(&ec, &dev);
+    expect("open", badge_err_is_ok(&ec));
+    bootmedia_blkdev_t media = {0};
+    register_blkdev_media(&media, &dev);
+    uint8_t const *base = disk + 2 * BLOCK_SIZE;
+    size_t         size = (BLOCK_COUNT - 2) * BLOCK_SIZE;
+    static uint8_t buf[BLOCK_SIZE * BLOCK_COUNT];
+
+    // Whole blocks are read in one transfer.
+    transfers = 0;
+    expect("aligned read", media.media.read(&media.media, 3 * BLOCK_SIZE, 10 * BLOCK_SIZE, buf) == 10 * BLOCK_SIZE);
+    expect("aligned data", !memcmp(buf, base + 3 * BLOCK_SIZE, 10 * BLOCK_SIZE));
+    expect("aligned transfers", transfers == 1);
+
+    // A partial block fills the cache; the next read of that block is served from it.
+    transfers = 0;
+    media.media.read(&media.media, 20 * BLOCK_SIZE + 100, 50, buf);
+    expect("partial data", !memcmp(buf, base + 20 * BLOCK_SIZE + 100, 50));
+    media.media.read(&media.media, 20 * BLOCK_SIZE + 300, 50, buf);
+    expect("cached partial data", !memcmp(buf, base + 20 * BLOCK_SIZE + 300, 50));
+    expect("partial transfers", transfers == 1);
+
+    // A cached block in the middle of a run splits it; the cached copy is not read again.
+    transfers = 0;
+    media.media.read(&media.media, 18 * BLOCK_SIZE, 5 * BLOCK_SIZE, buf);
+    expect("split data", !memcmp(buf, base + 18 * BLOCK_SIZE, 5 * BLOCK_SIZE));
+    expect("split transfers", transfers == 2);
+
+    // Reads past the end are truncated.
+    expect("truncated read", media.media.read(&media.media, size - 10, 100, buf) == 10);
+    expect("out of range read", media.media.read(&media.media, size + 1, 1, buf) == -1);
+
+    // Random reads.
+    for (int i = 0; i < 100000; i++) {
+        diskoff_t offset = rand() % size;
+        diskoff_t length = rand() % 4 ? rand() % 700 : rand() % (4 * BLOCK_SIZE);
+        diskoff_t avail  = length < (diskoff_t)size - offset ? length : (diskoff_t)size - offset;
+        memset(buf, 0, avail);
+        diskoff_t read = media.media.read(&media.media, offset, length, buf);
+        expect("random read", read == avail && !memcmp(buf, base + offset, avail));
+    }
+
+    // Without a cache, every read goes to the device.
+    dev.cache_read = false;
+    transfers      = 0;
+    media.media.read(&media.media, 20 * BLOCK_SIZE + 100, 50, buf);
+    media.media.read(&media.media, 20 * BLOCK_SIZE + 300, 50, buf);
+    expect("uncached data", !memcmp(buf, base + 20 * BLOCK_SIZE + 300, 50));
+    expect("uncached transfers", transfers == 2);
+
+    printf("correct:  %s\n", failures ? "NO" : "yes");
+    return failures != 0;
+}
@@ -0,0 +1,29 @@
+#!/usr/bin/env bash
+# SPDX-License-Identifier: MIT
+
+# Builds the size- and speed-optimized variants side by side and compares their sizes.
+# To compare boot time, flash each variant's kbbl.bin and compare the uptime of the "Jumping to" log line;
+# add -DKBBL_PROFILE=ON to CMAKE_FLAGS for a per-function breakdown.
+
+set -e
+cd "$(dirname "$0")/.."
+
+BUILDDIR="${BUILDDIR:-build-compare}"
+variants=(
+    "Os:-DKBBL_OPT=s -DKBBL_LTO=OFF"
+    "O2:-DKBBL_OPT=2 -DKBBL_LTO=OFF"
+    "Os-LTO:-DKBBL_OPT=s -DKBBL_LTO=ON"
+    "O2-LTO:-DKBBL_OPT=2 -DKBBL_LTO=ON"
+    "Perf:-DKBBL_OPT=s -DKBBL_LTO=OFF -DKBBL_PERF=ON"
+)
+
+printf "%-8s %8s %8s %8s %8s\n" variant text data bss bin
+for variant in "${variants[@]}"; do
+    name="${variant%%:*}"
+    flags="${variant#*:}"
+    cmake -B "$BUILDDIR/$name" $flags $CMAKE_FLAGS > /dev/null
+    cmake --build "$BUILDDIR/$name" > /dev/null
+    size=$(sed -n 's/^BADGER_OBJDUMP:FILEPATH=\(.*\)objdump$/\1size/p' "$BUILDDIR/$name/CMakeCache.txt")
+    read -r text data bss _ < <("$size" -B "$BUILDDIR/$name/kbbl.elf" | tail -1)
+    printf "%-8s %8d %8d %8d %8d\n" "$name" "$text" "$data" "$bss" "$(stat -c %s "$BUILDDIR/$name/kbbl.bin")"
+done
@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: MIT
+
+// Host benchmark for the Ed25519 verifier used by signed boot.
+// Build from the repository root with:
+//   cc -O2 -ffreestanding -idirafter include/badgelib -o ed25519-bench
+//      tools/ed25519-bench.c src/badgelib/ed25519.c src/badgelib/checksum.c src/badgelib/badge_strings.c
+// The target measures the same code at boot; see `bootprotocol_esp_boot`.
+
+#include "ed25519.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define READ_CYCLES() __rdtsc()
+#elif defined(__riscv)
+static inline uint64_t read_cycles() {
+    uint64_t cycles;
+    asm volatile("rdcycle %0" : "=r"(cycles));
+    return cycles;
+}
+#define READ_CYCLES() read_cycles()
+#else
+#define READ_CYCLES() 0
+#endif
+
+// RFC 8032 test 1: empty message.
+static uint8_t const pubkey[32] = {
+    0xd7, 0x5a, 0x98, 0x01, 0x82, 0xb1, 0x0a, 0xb7, 0xd5, 0x4b, 0xfe, 0xd3, 0xc9, 0x64, 0x07, 0x3a,
+    0x0e, 0xe1, 0x72, 0xf3, 0xda, 0xa6, 0x23, 0x25, 0xaf, 0x02, 0x1a, 0x68, 0xf7, 0x07, 0x51, 0x1a,
+};
+static uint8_t const signature[64] = {
+    0xe5, 0x56, 0x43, 0x00, 0xc3, 0x60, 0xac, 0x72, 0x90, 0x86, 0xe2, 0xcc, 0x80, 0x6e, 0x82, 0x8a,
+    0x84, 0x87, 0x7f, 0x1e, 0xb8, 0xe5, 0xd9, 0x74, 0xd8, 0x73, 0xe0, 0x65, 0x22, 0x49, 0x01, 0x55,
+    0x5f, 0xb8, 0x82, 0x15, 0x90, 0xa3, 0x3b, 0xac, 0xc6, 0x1e, 0x39, 0x70, 0x1c, 0xf9, 0xb4, 0x6b,
+    0xd2, 0x5b, 0xf5, 0xf0, 0x59, 0x5b, 0xbe, 0x24, 0x65, 0x51, 0x41, 0x43, 0x8e, 0x7a, 0x10, 0x0b,
+};
+
+int main() {
+    int const runs = 200;
+
+    // The first call also computes the curve constants.
+    uint64_t start = READ_CYCLES();
+    int      ok    = ed25519_verify(signature, pubkey, "", 0);
+    uint64_t first = READ_CYCLES() - start;
+
+    uint8_t bad[64];
+    for (int i = 0; i < 64; i++) {
+        bad[i] = signature[i];
+    }
+    bad[0] ^= 1;
+    int rejected = !ed25519_verify(bad, pubkey, "", 0);
+
+    clock_t  wall = clock();
+    uint64_t min  = UINT64_MAX;
+    for (int i = 0; i < runs; i++) {
+        start      = READ_CYCLES();
+        ok        &= ed25519_verify(signature, pubkey, "", 0);
+        uint64_t c = READ_CYCLES() - start;
+        if (c < min) {
+            min = c;
+        }
+    }
+    wall = clock() - wall;
+
+    printf("correct:  %s\n", ok && rejected ? "yes" : "NO");
+    printf("first:    %llu cycles (includes constant setup)\n", (unsigned long long)first);
+    printf("best:     %llu cycles\n", (unsigned long long)min);
+    printf("average:  %.1f us\n", 1e6 * wall / CLOCKS_PER_SEC / runs);
+    return !(ok && rejected);
+}
@@ -0,0 +1,402 @@
+// SPDX-License-Identifier: MIT
+
+// Host test for the FAT filesystem driver.
+// Build from the repository root with:
+//   cc -O2 -DHAS_FILESYS_FAT -Iinclude -Iinclude/badgelib -o fat-test tools/fat-test.c src/badgelib/badge_strings.c
+// Without arguments, FAT12, FAT16 and FAT32 images with a fragmented /boot/kernel.bin are built in memory and the
+// kernel is read back through the driver, whole, mapped and in random ranges, counting media requests per extent.
+// An image made by the real tools can be checked against the kernel file put on it with:
+//   ./fat-test fat.img kernel.bin
+// To fragment the kernel there, fill the filesystem with small files and delete every other one first, e.g.:
+//   mkfs.fat -C -F 16 fat.img 16384
+//   for i in $(seq 100); do mcopy -i fat.img filler.bin ::/f$i; done
+//   for i in $(seq 1 2 100); do mdel -i fat.img ::/f$i; done
+//   mmd -i fat.img ::/boot && mcopy -i fat.img kernel.bin ::/boot/kernel.bin
+
+#include "../src/arena.c"
+#include "../src/filesys/fat.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Sector size of the built images.
+#define SECT_SIZE   512
+// Size of the built kernel files.
+#define KERNEL_SIZE 50000
+// Number of sectors before the filesystem, to check that partition offsets are applied.
+#define PART_SECTS  16
+// Largest image size.
+#define IMAGE_MAX   (80000 * SECT_SIZE)
+// Size of the boot arena.
+#define ARENA_SIZE  4096
+
+// Boot arena the driver allocates from; only referenced through the linker symbols.
+static uint8_t arena_mem[ARENA_SIZE] __attribute__((used, aligned(16)));
+#define STRINGIFY(x)  #x
+#define XSTRINGIFY(x) STRINGIFY(x)
+asm(".global __start_free_sram\n.set __start_free_sram, arena_mem\n"
+    ".global __stop_free_sram\n.set __stop_free_sram, arena_mem + " XSTRINGIFY(ARENA_SIZE));
+
+// Media contents.
+static uint8_t *image;
+static size_t   image_len;
+// Kernel file contents.
+static uint8_t *kernel;
+static size_t   kernel_len;
+// Number of media requests.
+static int      requests;
+// Number of failed checks.
+static int      failures;
+// Driver under test; registered by its constructor.
+static filesys_type_t *fat_type;
+
+void logk(log_level_t level, char const *msg) {
+    (void)level;
+    (void)msg;
+}
+
+void logkf(log_level_t level, char const *msg, ...) {
+    (void)level;
+    (void)msg;
+}
+
+void filesys_type_register(filesys_type_t *type) {
+    fat_type = type;
+}
+
+static diskoff_t media_read(bootmedia_t *media, diskoff_t offset, diskoff_t length, void *mem) {
+    (void)media;
+    requests++;
+    if (offset < 0 || length < 0 || (size_t)offset > image_len) {
+        return -1;
+    }
+    if ((size_t)(offset + length) > image_len) {
+        length = image_len - offset;
+    }
+    memcpy(mem, image + offset, length);
+    return length;
+}
+
+static bool media_mmap(bootmedia_t *media, diskoff_t offset, diskoff_t length, size_t vaddr) {
+    // Mapping is modelled as a copy to the virtual address.
+    return media_read(media, offset, length, (void *)vaddr) == length;
+}
+
+static bootmedia_t media = {
+    .read = media_read,
+    .mmap = media_mmap,
+};
+
+static void expect(char const *name, char const *what, bool ok) {
+    if (!ok && failures++ < 20) {
+        printf("FAIL %s: %s\n", name, what);
+    }
+}
+
+// Open the kernel on the current image and check it against the kernel contents.
+static void check_image(char const *name, diskoff_t part_off, size_t want_extents) {
+    ARENA_SCOPE(image);
+    partition_t part = {
+        .media  = &media,
+        .offset = part_off,
+        .length = image_len - part_off,
+    };
+    filesys_t filesys;
+    file_t    file = {0};
+    expect(name, "ident", fat_type->ident(&part));
+    if (!fat_type->read(&part, &filesys, &file)) {
+        expect(name, "open", false);
+        return;
+    }
+    expect(name, "size", file.size == (diskoff_t)kernel_len);
+    if (want_extents) {
+        expect(name, "extents", extents_num == want_extents);
+    }
+
+    // A whole read takes one media request per extent.
+    static uint8_t buf[IMAGE_MAX];
+    memset(buf, 0, kernel_len);
+    requests = 0;
+    expect(name, "read", file.read(&file, 0, kernel_len, buf) == (diskoff_t)kernel_len);
+    expect(name, "read data", !memcmp(buf, kernel, kernel_len));
+    expect(name, "read requests", requests == (int)extents_num);
+
+    memset(buf, 0, kernel_len);
+    expect(name, "mmap", file.mmap(&file, 0, kernel_len, (size_t)buf));
+    expect(name, "mmap data", !memcmp(buf, kernel, kernel_len));
+
+    // Reads past the end are truncated, reads starting past it fail.
+    expect(name, "truncated read", file.read(&file, kernel_len - 10, 100, buf) == 10);
+    expect(name, "out of range read", file.read(&file, kernel_len + 1, 1, buf) == -1);
+
+    for (int i = 0; i < 2000; i++) {
+        diskoff_t offset = rand() % kernel_len;
+        diskoff_t length = rand() % (kernel_len - offset + 1);
+        memset(buf, 0, length);
+        expect(name, "random read", file.read(&file, offset, length, buf) == length);
+        expect(name, "random data", !memcmp(buf, kernel + offset, length));
+    }
+}
+
+
+
+// Layout of the image being built.
+static struct {
+    int      type;
+    uint32_t clus_sects;
+    uint32_t fat_sects;
+    uint32_t fats;
+    uint32_t root_ents;
+    uint32_t data_sect;
+    uint32_t clusters;
+    uint32_t next_free;
+    uint8_t *base;
+    // Cluster chain of the kernel.
+    uint32_t kernel_chain[KERNEL_SIZE / SECT_SIZE + 1];
+} img;
+
+// End of chain marker for the current FAT type.
+static uint32_t img_eoc() {
+    return img.type == 12 ? 0xfff : img.type == 16 ? 0xffff : 0x0fffffff;
+}
+
+// Set a FAT entry in every FAT.
+static void img_set_fat(uint32_t clus, uint32_t value) {
+    for (uint32_t i = 0; i < img.fats; i++) {
+        uint8_t *fat = img.base + (1 + i * img.fat_sects) * SECT_SIZE;
+        if (img.type == 12) {
+            uint8_t *ent = fat + clus + clus / 2;
+            uint16_t old = ent[0] | ent[1] << 8;
+            uint16_t val = clus & 1 ? (old & 0x000f) | value << 4 : (old & 0xf000) | value;
+            ent[0]       = val;
+            ent[1]       = val >> 8;
+        } else if (img.type == 16) {
+            fat[2 * clus]     = value;
+            fat[2 * clus + 1] = value >> 8;
+        } else {
+            for (int j = 0; j < 4; j++) fat[4 * clus + j] = value >> (8 * j);
+        }
+    }
+}
+
+// Get a pointer to a cluster.
+static uint8_t *img_clus(uint32_t clus) {
+    return img.base + (img.data_sect + (clus - 2) * img.clus_sects) * SECT_SIZE;
+}
+
+// Allocate a chain of `count` clusters in `runs` runs (at most `count`), each followed by a cluster of another file.
+static uint32_t img_alloc(uint32_t count, uint32_t runs, uint32_t *chain) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (i && i * runs / count != (i - 1) * runs / count) {
+            img_set_fat(img.next_free++, img_eoc());
+        }
+        chain[i] = img.next_free++;
+        if (i) {
+            img_set_fat(chain[i - 1], chain[i]);
+        }
+    }
+    img_set_fat(chain[count - 1], img_eoc());
+    return chain[0];
+}
+
+// Write `len` bytes of `data` to a cluster chain.
+static void img_write(uint32_t const *chain, void const *data, size_t len) {
+    size_t clus_size = img.clus_sects * SECT_SIZE;
+    for (size_t off = 0; off < len; off += clus_size) {
+        size_t chunk = len - off < clus_size ? len - off : clus_size;
+        memcpy(img_clus(chain[off / clus_size]), (uint8_t const *)data + off, chunk);
+    }
+}
+
+// Make a directory entry.
+static fat_dirent_t img_dirent(char const name[11], uint8_t attr, uint32_t clus, uint32_t size) {
+    fat_dirent_t ent = {
+        .attr    = attr,
+        .clus_hi = clus >> 16,
+        .clus_lo = clus,
+        .size    = size,
+    };
+    memcpy(ent.name, name, 11);
+    return ent;
+}
+
+// Build a FAT image holding /BOOT/KERNEL.BIN fragmented into `runs` extents.
+static void build_image(int type, uint32_t total, uint32_t clus_sects, uint32_t runs) {
+    image_len = (size_t)(PART_SECTS + total) * SECT_SIZE;
+    memset(image, 0, image_len);
+    img.base       = image + PART_SECTS * SECT_SIZE;
+    img.type       = type;
+    img.clus_sects = clus_sects;
+    img.fats       = 2;
+    img.root_ents  = type == 32 ? 0 : 512;
+    img.fat_sects  = ((total / clus_sects + 2) * type / 8 + SECT_SIZE - 1) / SECT_SIZE;
+    img.data_sect  = 1 + img.fats * img.fat_sects + img.root_ents * sizeof(fat_dirent_t) / SECT_SIZE;
+    img.clusters   = (total - img.data_sect) / clus_sects;
+    img.next_free  = 2;
+
+    fat_bpb_t bpb = {
+        .jump          = {0xeb, 0x3c, 0x90},
+        .oem           = "MSWIN4.1",
+        .sect_size     = SECT_SIZE,
+        .clus_sects    = clus_sects,
+        .rsvd_sects    = 1,
+        .fats          = img.fats,
+        .root_ents     = img.root_ents,
+        .total_sects16 = total < 65536 ? total : 0,
+        .media         = 0xf8,
+        .fat_sects16   = type == 32 ? 0 : img.fat_sects,
+        .hidden_sects  = PART_SECTS,
+        .total_sects32 = total < 65536 ? 0 : total,
+        .fat_sects32   = type == 32 ? img.fat_sects : 0,
+        .root_clus     = type == 32 ? 2 : 0,
+    };
+    memcpy(img.base, &bpb, sizeof(bpb));
+    img.base[510] = 0x55;
+    img.base[511] = 0xaa;
+    img_set_fat(0, img_eoc() & ~7);
+    img_set_fat(1, img_eoc());
+
+    // The FAT32 root directory is the first cluster.
+    uint32_t root_chain[1];
+    if (type == 32) {
+        img_alloc(1, 1, root_chain);
+    }
+
+    // Kernel, fragmented.
+    size_t   clus_size   = clus_sects * SECT_SIZE;
+    uint32_t kernel_clus = img_alloc((kernel_len + clus_size - 1) / clus_size, runs, img.kernel_chain);
+    img_write(img.kernel_chain, kernel, kernel_len);
+
+    // The boot directory takes two clusters in two runs; the kernel entry is in the second.
+    // Deleted, long filename and volume label entries come before it and must be skipped.
+    static fat_dirent_t boot_ents[2 * 64 * SECT_SIZE / sizeof(fat_dirent_t)];
+    size_t              boot_num = 0;
+    uint32_t            boot_chain[2];
+    uint32_t            boot_clus = img_alloc(2, 2, boot_chain);
+    memset(boot_ents, 0, sizeof(boot_ents));
+    boot_ents[boot_num++] = img_dirent(".          ", FAT_ATTR_DIR, boot_clus, 0);
+    boot_ents[boot_num++] = img_dirent("..         ", FAT_ATTR_DIR, 0, 0);
+    boot_ents[boot_num++] = img_dirent("KERNEL  BIN", FAT_ATTR_LFN, 0, 0);
+    boot_ents[boot_num++] = img_dirent("\xe5" "ERNEL  BIN", 0x20, 3, 1234);
+    boot_ents[boot_num++] = img_dirent("KERNEL  BIN", FAT_ATTR_VOLUME, 0, 0);
+    while (boot_num < clus_size / sizeof(fat_dirent_t) + 3) {
+        char name[12];
+        snprintf(name, sizeof(name), "FILE%04zuBIN", boot_num);
+        boot_ents[boot_num++] = img_dirent(name, 0x20, 0, 0);
+    }
+    boot_ents[boot_num++] = img_dirent("KERNEL  BIN", 0x20, kernel_clus, kernel_len);
+    img_write(boot_chain, boot_ents, 2 * clus_size);
+
+    // Root directory with a volume label and the boot directory.
+    fat_dirent_t root_ents[] = {
+        img_dirent("TESTVOLUME ", FAT_ATTR_VOLUME, 0, 0),
+        img_dirent("BOOT       ", FAT_ATTR_LFN, 0, 0),
+        img_dirent("BOOT       ", FAT_ATTR_DIR, boot_clus, 0),
+    };
+    if (type == 32) {
+        img_write(root_chain, root_ents, sizeof(root_ents));
+    } else {
+        memcpy(img.base + (1 + img.fats * img.fat_sects) * SECT_SIZE, root_ents, sizeof(root_ents));
+    }
+}
+
+// Read a whole file.
+static uint8_t *read_file(char const *path, size_t *len) {
+    FILE *fd = fopen(path, "rb");
+    if (!fd) {
+        perror(path);
+        exit(1);
+    }
+    fseek(fd, 0, SEEK_END);
+    *len = ftell(fd);
+    rewind(fd);
+    uint8_t *data = malloc(*len);
+    if (fread(data, 1, *len, fd) != *len) {
+        perror(path);
+        exit(1);
+    }
+    fclose(fd);
+    return data;
+}
+
+int main(int argc, char **argv) {
+    if (argc == 3) {
+        image  = read_file(argv[1], &image_len);
+        kernel = read_file(argv[2], &kernel_len);
+        check_image(argv[1], 0, 0);
+        printf("correct:  %s\n", failures ? "NO" : "yes");
+        return failures != 0;
+    } else if (argc != 1) {
+        fprintf(stderr, "Usage: %s [image kernel]\n", argv[0]);
+        return 1;
+    }
+
+    image      = malloc(IMAGE_MAX);
+    kernel     = malloc(KERNEL_SIZE);
+    kernel_len = KERNEL_SIZE;
+    for (size_t i = 0; i < kernel_len; i++) {
+        kernel[i] = rand();
+    }
+    diskoff_t part_off = PART_SECTS * SECT_SIZE;
+
+    // Each FAT type, contiguous, fragmented and with the most extents the driver keeps.
+    static struct {
+        char const *name;
+        int         type;
+        uint32_t    total;
+        uint32_t    clus_sects;
+    } const layouts[] = {
+        {"FAT12", 12, 4000, 1},
+        {"FAT16", 16, 20000, 1},
+        {"FAT16, 4 sectors per cluster", 16, 20000, 4},
+        {"FAT32", 32, 70000, 1},
+    };
+    for (size_t i = 0; i < sizeof(layouts) / sizeof(*layouts); i++) {
+        uint32_t const runs[]    = {1, 7, FAT_MAX_EXTENTS};
+        size_t         clus_size = layouts[i].clus_sects * SECT_SIZE;
+        uint32_t       clusters  = (kernel_len + clus_size - 1) / clus_size;
+        for (size_t j = 0; j < sizeof(runs) / sizeof(*runs); j++) {
+            uint32_t extents = runs[j] < clusters ? runs[j] : clusters;
+            build_image(layouts[i].type, layouts[i].total, layouts[i].clus_sects, extents);
+            char name[64];
+            snprintf(name, sizeof(name), "%s in %u extents", layouts[i].name, extents);
+            expect(name, "FAT type", img.type == (img.clusters < 4085 ? 12 : img.clusters < 65525 ? 16 : 32));
+            check_image(name, part_off, extents);
+        }
+    }
+
+    // FAT32 with mirroring disabled reads the active FAT, not the first.
+    build_image(32, 70000, 1, 7);
+    ((fat_bpb_t *)img.base)->ext_flags = 0x81;
+    memset(img.base + SECT_SIZE, 0, img.fat_sects * SECT_SIZE);
+    check_image("FAT32 with the second FAT active", part_off, 7);
+
+    // Too many fragments, a missing kernel and a truncated cluster chain are rejected.
+    partition_t part = {.media = &media, .offset = part_off};
+    filesys_t   filesys;
+    file_t      file;
+    build_image(16, 20000, 1, FAT_MAX_EXTENTS + 1);
+    part.length = image_len - part_off;
+    expect("too many extents", "open", !fat_type->read(&part, &filesys, &file));
+    build_image(16, 20000, 1, 1);
+    memcpy(img.base + (1 + img.fats * img.fat_sects) * SECT_SIZE + 2 * sizeof(fat_dirent_t), "BOOTX", 5);
+    expect("no kernel", "open", !fat_type->read(&part, &filesys, &file));
+    build_image(16, 20000, 1, 1);
+    img_set_fat(img.kernel_chain[10], img_eoc());
+    expect("short chain", "open", !fat_type->read(&part, &filesys, &file));
+
+    // The extent list needs room for the most extents the driver keeps; less is an error.
+    build_image(16, 20000, 1, 7);
+    size_t used = arena_used();
+    for (size_t less = 0; less < 2; less++) {
+        ARENA_SCOPE(full);
+        arena_alloc(ARENA_SIZE - used - FAT_MAX_EXTENTS * sizeof(fat_extent_t) + less * 8, 1);
+        bool opened = fat_type->read(&part, &filesys, &file);
+        expect(less ? "arena full" : "arena just large enough", "open", opened == !less);
+    }
+    expect("arena", "freed", arena_used() == used);
+
+    printf("correct:  %s\n", failures ? "NO" : "yes");
+    return failures != 0;
+}
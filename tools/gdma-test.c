@@ -0,0 +1,187 @@
+// SPDX-License-Identifier: MIT
+
+// Host test for the GDMA copy driver against a model of the GDMA channel.
+// Build from the repository root with:
+//   cc -O2 -DHAS_DMA_COPY -Iinclude -Iinclude/badgelib -Iport/esp32c6/include -o gdma-test tools/gdma-test.c
+// The model walks the transmit and receive descriptor rings like the hardware, a few status polls after a transfer
+// is started, and fails on anything the hardware would not accept: descriptors not owned by the DMA, an EOF before
+// the end of the transmit ring, receive buffers too small for the data, burst mode on unaligned buffers or a channel
+// not in memory-to-memory mode. Copies and chunked copies of many lengths and alignments are checked against the
+// source, and every chunk must have arrived when it is handed to the CPU.
+
+#include "soc/gdma_struct.h"
+#include "soc/pcr_struct.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Route the driver's register accesses to the model.
+static gdma_dev_t *gdma_model();
+#define GDMA (*gdma_model())
+
+#include "../port/esp32c6/src/esp_gdma.c"
+#include "../src/dma.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Size of the simulated SRAM.
+#define SRAM_SIZE  (1 << 20)
+// Number of status polls before the model runs a transfer.
+#define GDMA_POLLS 5
+
+// Simulated SRAM; the DMA only reaches this.
+static uint8_t sram[SRAM_SIZE];
+#define STRINGIFY(x)  #x
+#define XSTRINGIFY(x) STRINGIFY(x)
+asm(".global __start_sram\n.set __start_sram, sram\n"
+    ".global __stop_sram\n.set __stop_sram, sram + " XSTRINGIFY(SRAM_SIZE));
+
+pcr_dev_t         PCR;
+// Model register state.
+static gdma_dev_t model;
+// Status polls since the transfer was started.
+static int        polls;
+// Number of transfers run.
+static int        transfers;
+// Number of failed checks.
+static int        failures;
+
+static void expect(char const *what, bool ok) {
+    if (!ok && failures++ < 20) {
+        printf("FAIL %s\n", what);
+    }
+}
+
+// Check a descriptor handed to the DMA.
+static void gdma_check_desc(gdma_desc_t const *desc, bool burst) {
+    expect("descriptor owned by the DMA", desc->owner);
+    expect("descriptor size", desc->size > 0 && desc->size <= GDMA_DESC_MAX);
+    expect("buffer in SRAM", IS_SRAM_RANGE(desc->buffer, desc->size));
+    if (burst) {
+        expect("burst buffer aligned", !((size_t)desc->buffer & 3) && !(desc->size & 3));
+    }
+}
+
+// Run the started transfer by walking the descriptor rings.
+static void gdma_run(gdma_chn_reg_t *ch) {
+    expect("memory-to-memory mode", ch->in.in_conf0.mem_trans_en);
+    bool         burst  = ch->in.in_conf0.in_data_burst_en || ch->out.out_conf0.out_data_burst_en;
+    gdma_desc_t *out    = out_desc;
+    gdma_desc_t *in     = in_desc;
+    size_t       in_off = 0;
+    while (out) {
+        gdma_check_desc(out, burst);
+        expect("transmit length", out->length == out->size);
+        for (size_t i = 0; i < out->length; i++) {
+            if (!in || !in->owner) {
+                expect("receive descriptor for every byte", false);
+                return;
+            }
+            if (!in_off) {
+                gdma_check_desc(in, burst);
+            }
+            ((uint8_t *)in->buffer)[in_off++] = ((uint8_t const *)out->buffer)[i];
+            if (in_off == in->size) {
+                in->length = in_off;
+                in->owner  = false;
+                in         = in->next;
+                in_off     = 0;
+            }
+        }
+        out->owner = false;
+        bool eof   = out->suc_eof;
+        out        = out->next;
+        expect("EOF on the last transmit descriptor only", eof == !out);
+    }
+    if (in && in_off) {
+        in->length  = in_off;
+        in->owner   = false;
+        in->suc_eof = true;
+    }
+    transfers++;
+    ch->in.in_link.inlink_start                        = false;
+    ch->out.out_link.outlink_start                     = false;
+    model.in_intr[GDMA_COPY_CH].raw.in_suc_eof_int_raw = true;
+}
+
+static gdma_dev_t *gdma_model() {
+    gdma_chn_reg_t *ch = (gdma_chn_reg_t *)&model.channel[GDMA_COPY_CH];
+    if (model.in_intr[GDMA_COPY_CH].clr.val) {
+        model.in_intr[GDMA_COPY_CH].raw.val = 0;
+        model.in_intr[GDMA_COPY_CH].clr.val = 0;
+    }
+    if (ch->in.in_link.inlink_start && ch->out.out_link.outlink_start) {
+        expect("clock enabled", PCR.gdma_conf.gdma_clk_en && !PCR.gdma_conf.gdma_rst_en && model.misc_conf.clk_en);
+        if (++polls > GDMA_POLLS) {
+            polls = 0;
+            gdma_run(ch);
+        }
+    }
+    return &model;
+}
+
+void mem_copy(void *dest, void const *src, size_t size) {
+    memmove(dest, src, size);
+}
+
+// Source of the chunked copy being checked, and bytes checked so far.
+static uint8_t const *chunk_src;
+static size_t         chunk_seen;
+
+static void check_chunk(void *cookie, void const *mem, size_t len) {
+    (void)cookie;
+    expect("chunk data", !memcmp(mem, chunk_src + chunk_seen, len));
+    // The chunk must not overlap the receive buffers of a running transfer.
+    for (gdma_desc_t const *in = in_desc; gdma_busy && in; in = in->next) {
+        uint8_t const *buf = in->buffer;
+        expect("chunk not in flight", (uint8_t const *)mem + len <= buf || (uint8_t const *)mem >= buf + in->size);
+    }
+    chunk_seen += len;
+}
+
+int main() {
+    uint8_t *src = sram;
+    uint8_t *dst = sram + SRAM_SIZE / 2;
+    for (size_t len = 0; len < 200000; len = len * 3 + 1) {
+        for (int align = 0; align < 4; align++) {
+            for (size_t i = 0; i < len + 8; i++) src[i] = rand();
+
+            // Chunked copy, misaligned by `align` on the source and the low bit on the destination.
+            memset(dst, 0, len + 8);
+            chunk_src  = src + align;
+            chunk_seen = 0;
+            dma_copy_chunked(dst + (align & 1), src + align, len, 4096, check_chunk, NULL);
+            dma_copy_wait();
+            expect("chunked length", chunk_seen == len);
+            expect("chunked data", !memcmp(dst + (align & 1), src + align, len));
+            expect("chunked bounds", dst[len + (align & 1)] == 0 && (!(align & 1) || dst[0] == 0));
+
+            // Single copy, longer than a descriptor ring for larger lengths.
+            memset(dst, 0, len + 8);
+            int before = transfers;
+            dma_copy_start(dst + align, src, len);
+            dma_copy_wait();
+            expect("copy data", !memcmp(dst + align, src, len));
+            expect("copy bounds", dst[len + align] == 0);
+            size_t ring = GDMA_DESC_COUNT * GDMA_DESC_MAX;
+            expect("transfers per copy", transfers - before == (int)((len + ring - 1) / ring));
+        }
+    }
+
+    // Buffers outside SRAM and overlapping buffers are copied by the CPU.
+    static uint8_t outside[100];
+    int            before = transfers;
+    dma_copy_start(outside, src, sizeof(outside));
+    expect("copy outside SRAM", !memcmp(outside, src, sizeof(outside)));
+    memcpy(dst, src, 1000);
+    dma_copy_start(dst + 10, dst, 990);
+    dma_copy_wait();
+    expect("overlapping copy", !memcmp(dst + 10, src, 990));
+    expect("CPU copies", transfers == before);
+
+    printf("correct:  %s\n", failures ? "NO" : "yes");
+    return failures != 0;
+}
@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+
+# Appends a hot range block to an ESP image, listing kernel code for the bootloader to preload into the instruction
+# cache before handover (ESP_PRELOAD_WINDOW). Ranges are ADDR:LEN in hex or function names looked up in --elf.
+# The block (magic "KBHR", range count, then address/length pairs) follows the image and any signature block,
+# so sign the image first. Usage:
+#   tools/hot-ranges.py kernel.bin kernel-hot.bin --elf kernel.elf kernel_init 0x42010000:0x800
+
+import argparse, subprocess
+from pathlib import Path
+
+HOT_MAGIC = b"KBHR"
+SIG_MAGIC = b"KBSG"
+SIG_BLOCK_LEN = 68
+# Ranges the bootloader uses; it preloads no more than the cache size in total.
+HOT_MAX = 7
+
+def image_end(raw):
+    # Walk the segment table to find the checksum byte, then skip the appended SHA256 and signature.
+    seg_num = raw[1]
+    off = 24
+    for _ in range(seg_num):
+        off += 8 + int.from_bytes(raw[off + 4:off + 8], "little")
+    off += 15 - off % 16 + 1
+    if raw[23]:
+        off += 32
+    if raw[off:off + 4] == SIG_MAGIC:
+        off += SIG_BLOCK_LEN
+    return off
+
+def symbol_sizes(elf, nm):
+    symbols = {}
+    out = subprocess.run([nm, "--defined-only", "--print-size", elf], stdout=subprocess.PIPE, check=True)
+    for line in out.stdout.decode().splitlines():
+        fields = line.split()
+        if len(fields) == 4 and fields[2] in "tT":
+            symbols[fields[3]] = (int(fields[0], 16), int(fields[1], 16))
+    return symbols
+
+def main():
+    parser = argparse.ArgumentParser(description="Append a hot range block to an ESP image")
+    parser.add_argument("input", type=Path)
+    parser.add_argument("output", type=Path)
+    parser.add_argument("ranges", nargs="+", help="ADDR:LEN in hex, or a function name from --elf")
+    parser.add_argument("--elf", help="ELF file of the kernel, to look up function names")
+    parser.add_argument("--nm", default="riscv32-unknown-linux-gnu-nm", help="nm for the target")
+    args = parser.parse_args()
+
+    symbols = symbol_sizes(args.elf, args.nm) if args.elf else {}
+    ranges = []
+    for spec in args.ranges:
+        if ":" in spec:
+            addr, length = spec.split(":")
+            ranges.append((int(addr, 16), int(length, 16)))
+        elif spec in symbols:
+            ranges.append(symbols[spec])
+        else:
+            parser.error("unknown range or function: %s" % spec)
+    if len(ranges) > HOT_MAX:
+        parser.error("at most %d ranges are used" % HOT_MAX)
+
+    raw = args.input.read_bytes()
+    block = HOT_MAGIC + len(ranges).to_bytes(4, "little")
+    for addr, length in ranges:
+        block += addr.to_bytes(4, "little") + length.to_bytes(4, "little")
+    args.output.write_bytes(raw[:image_end(raw)] + block)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,252 @@
+// SPDX-License-Identifier: MIT
+
+// Host test and benchmark for the 64-bit division routines in int_routines.c.
+// Build from the repository root with:
+//   cc -O2 -o int-routines-test tools/int-routines-test.c src/badgelib/int_routines.c
+// Every path is checked against the host's native division; the benchmark compares each path with the
+// bit-at-a-time loop int_routines.c used before. The bit counting and byte swapping routines are checked against
+// bit-by-bit references, not the host's builtins, which may call the very routines under test.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define READ_CYCLES() __rdtsc()
+#elif defined(__riscv)
+static inline uint64_t read_cycles() {
+    uint64_t cycles;
+    asm volatile("rdcycle %0" : "=r"(cycles));
+    return cycles;
+}
+#define READ_CYCLES() read_cycles()
+#else
+#define READ_CYCLES() 0
+#endif
+
+uint64_t __udivmoddi4(uint64_t a, uint64_t b, uint64_t *rem);
+uint64_t __udivdi3(uint64_t a, uint64_t b);
+uint64_t __umoddi3(uint64_t a, uint64_t b);
+int64_t  __divmoddi4(int64_t a, int64_t b, int64_t *rem);
+int64_t  __divdi3(int64_t a, int64_t b);
+int64_t  __moddi3(int64_t a, int64_t b);
+int      __clzsi2(uint32_t a);
+int      __clzdi2(uint64_t a);
+int      __ctzsi2(uint32_t a);
+int      __ctzdi2(uint64_t a);
+int      __ffssi2(uint32_t a);
+int      __ffsdi2(uint64_t a);
+int      __clrsbsi2(int32_t a);
+int      __clrsbdi2(int64_t a);
+int      __popcountsi2(uint32_t a);
+int      __popcountdi2(uint64_t a);
+int      __paritysi2(uint32_t a);
+int      __paritydi2(uint64_t a);
+int32_t  __bswapsi2(int32_t a);
+int64_t  __bswapdi2(int64_t a);
+
+// Values around every power of two and ten, and the extremes.
+static uint64_t edges[512];
+static size_t   edges_len;
+// Number of failed checks.
+static int      failures;
+
+// The bit-at-a-time division int_routines.c used before, for comparison.
+static uint64_t old_udivdi3(uint64_t remainder, uint64_t divisor) {
+    uint64_t     result = 0;
+    unsigned int shift  = 0;
+    while (!(divisor & (1ull << 63))) {
+        divisor <<= 1;
+        shift++;
+    }
+    for (unsigned int i = 0; i <= shift; i++) {
+        if (remainder >= divisor) {
+            result    |= 1ull << (shift - i);
+            remainder -= divisor;
+        }
+        divisor >>= 1;
+    }
+    return result;
+}
+
+static uint64_t random64() {
+    uint64_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value = (value << 16) ^ (rand() & 0xffff);
+    }
+    // Spread the bit lengths evenly.
+    return value >> (rand() % 64);
+}
+
+static void check_unsigned(uint64_t a, uint64_t b) {
+    uint64_t rem;
+    uint64_t quot = __udivmoddi4(a, b, &rem);
+    if (quot != a / b || rem != a % b || __udivdi3(a, b) != a / b || __umoddi3(a, b) != a % b) {
+        if (failures++ < 10) {
+            printf("FAIL %llu / %llu\n", (unsigned long long)a, (unsigned long long)b);
+        }
+    }
+}
+
+static void check_signed(int64_t a, int64_t b) {
+    if (a == INT64_MIN && b == -1) {
+        return;
+    }
+    int64_t rem;
+    int64_t quot = __divmoddi4(a, b, &rem);
+    if (quot != a / b || rem != a % b || __divdi3(a, b) != a / b || __moddi3(a, b) != a % b) {
+        if (failures++ < 10) {
+            printf("FAIL %lld / %lld (signed)\n", (long long)a, (long long)b);
+        }
+    }
+}
+
+static void check(uint64_t a, uint64_t b) {
+    if (b) {
+        check_unsigned(a, b);
+        check_signed((int64_t)a, (int64_t)b);
+    }
+}
+
+// Bit-by-bit reference for the bit counting routines on the low `bits` bits of `value`.
+typedef struct {
+    int clz, ctz, ffs, clrsb, popcount, parity;
+} bits_t;
+
+static bits_t ref_bits(uint64_t value, int bits) {
+    bits_t res = {.clz = bits, .ctz = bits};
+    int    top = (value >> (bits - 1)) & 1;
+    for (int i = 0; i < bits; i++) {
+        if ((value >> i) & 1) {
+            res.clz = bits - 1 - i;
+            res.popcount++;
+            if (!res.ffs) {
+                res.ctz = i;
+                res.ffs = i + 1;
+            }
+        }
+    }
+    for (int i = bits - 2; i >= 0 && (int)((value >> i) & 1) == top; i--) res.clrsb++;
+    res.parity = res.popcount & 1;
+    return res;
+}
+
+static void check_bits(uint64_t value) {
+    uint32_t low     = value;
+    bits_t   ref     = ref_bits(low, 32);
+    uint32_t swapped = (low >> 24) | ((low >> 8) & 0xff00) | ((low << 8) & 0xff0000) | (low << 24);
+    bool     ok      = __clzsi2(low) == ref.clz && __ctzsi2(low) == ref.ctz && __ffssi2(low) == ref.ffs;
+    ok               = ok && __clrsbsi2((int32_t)low) == ref.clrsb && __popcountsi2(low) == ref.popcount;
+    ok               = ok && __paritysi2(low) == ref.parity && (uint32_t)__bswapsi2((int32_t)low) == swapped;
+
+    ref                = ref_bits(value, 64);
+    uint64_t swapped64 = 0;
+    for (int i = 0; i < 8; i++) swapped64 |= ((value >> (8 * i)) & 0xff) << (56 - 8 * i);
+    ok = ok && __clzdi2(value) == ref.clz && __ctzdi2(value) == ref.ctz && __ffsdi2(value) == ref.ffs;
+    ok = ok && __clrsbdi2((int64_t)value) == ref.clrsb && __popcountdi2(value) == ref.popcount;
+    ok = ok && __paritydi2(value) == ref.parity && (uint64_t)__bswapdi2((int64_t)value) == swapped64;
+
+    if (!ok && failures++ < 10) {
+        printf("FAIL bit routines on %016llx\n", (unsigned long long)value);
+    }
+}
+
+// Average cycles per call of `func` over `count` dividends from `dividend`.
+static double bench(uint64_t (*func)(uint64_t, uint64_t), uint64_t (*dividend)(), uint64_t divisor) {
+    enum { count = 4096 };
+    static uint64_t nums[count];
+    for (int i = 0; i < count; i++) {
+        nums[i] = dividend();
+    }
+    uint64_t volatile sink = 0;
+    uint64_t best          = UINT64_MAX;
+    for (int run = 0; run < 20; run++) {
+        uint64_t start = READ_CYCLES();
+        for (int i = 0; i < count; i++) {
+            sink += func(nums[i], divisor);
+        }
+        uint64_t took = READ_CYCLES() - start;
+        if (took < best) {
+            best = took;
+        }
+    }
+    return (double)best / count;
+}
+
+// Print the cycles per call of the old and new division.
+static void bench_row(char const *name, uint64_t (*dividend)(), uint64_t divisor) {
+    double old = bench(old_udivdi3, dividend, divisor);
+    printf("%-13s %7.1f %7.1f\n", name, old, bench(__udivdi3, dividend, divisor));
+}
+
+static uint64_t small_dividend() {
+    return rand();
+}
+
+static uint64_t large_dividend() {
+    return random64() | (1ull << 63);
+}
+
+static uint64_t large_divisor() {
+    return random64() | (1ull << 40);
+}
+
+int main() {
+    // Edge values.
+    for (int i = 0; i < 64; i++) {
+        edges[edges_len++] = (1ull << i) - 1;
+        edges[edges_len++] = 1ull << i;
+        edges[edges_len++] = (1ull << i) + 1;
+        edges[edges_len++] = -(1ull << i);
+    }
+    for (uint64_t pow = 1; pow <= UINT64_MAX / 10; pow *= 10) {
+        edges[edges_len++] = pow - 1;
+        edges[edges_len++] = pow;
+        edges[edges_len++] = pow + 1;
+    }
+    edges[edges_len++] = UINT64_MAX;
+    edges[edges_len++] = UINT64_MAX - 1;
+    edges[edges_len++] = INT64_MAX;
+    edges[edges_len++] = 0xffffffff00000000;
+    edges[edges_len++] = 0x00000000ffffffff;
+    for (size_t i = 0; i < edges_len; i++) {
+        check_bits(edges[i]);
+        for (size_t j = 0; j < edges_len; j++) {
+            check(edges[i], edges[j]);
+        }
+    }
+
+    // Multiples of the reciprocal divisors and their neighbours.
+    uint64_t const constants[] = {10, 1000, 1000000};
+    for (size_t i = 0; i < sizeof(constants) / sizeof(constants[0]); i++) {
+        uint64_t div = constants[i];
+        for (uint64_t quot = UINT64_MAX / div; quot > UINT64_MAX / div - 100000; quot--) {
+            check(quot * div, div);
+            check(quot * div - 1, div);
+            check(quot * div + div - 1, div);
+        }
+        for (int j = 0; j < 1000000; j++) {
+            check(random64(), div);
+        }
+    }
+
+    // Random operands of all lengths.
+    for (int i = 0; i < 10000000; i++) {
+        check(random64(), random64());
+    }
+    for (int i = 0; i < 1000000; i++) {
+        check_bits(random64());
+        check_bits(-random64());
+    }
+    printf("correct:  %s\n", failures ? "NO" : "yes");
+
+    // Cycles per call of each path.
+    printf("path              old     new\n");
+    bench_row("32-bit", small_dividend, 1000);
+    bench_row("64-bit / 1000", large_dividend, 1000);
+    bench_row("64-bit / 7", large_dividend, 7);
+    bench_row("64 / 64-bit", large_dividend, large_divisor());
+    return failures != 0;
+}
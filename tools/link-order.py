@@ -0,0 +1,40 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+
+# Generates the linker function order from the boot log of a KBBL_PROFILE_FUNCS build.
+# The functions entered during boot are placed first in `.text` in order of first use; functions that did not run
+# (mostly error paths) end up after them. Usage:
+#   tools/link-order.py build/kbbl.elf boot.log > port/esp32c6/link-order.ld
+
+import re, argparse, subprocess
+
+parser = argparse.ArgumentParser(description="Generate a linker function order from a boot log")
+parser.add_argument("elf", help="ELF file of the KBBL_PROFILE_FUNCS build that produced the log")
+parser.add_argument("log", help="Boot log containing the 'Boot function' lines")
+parser.add_argument("--nm", default="riscv32-unknown-linux-gnu-nm", help="nm for the target")
+args = parser.parse_args()
+
+# Function symbols by address.
+symbols = {}
+nm = subprocess.run([args.nm, "--defined-only", args.elf], stdout=subprocess.PIPE, check=True)
+for line in nm.stdout.decode().splitlines():
+    fields = line.split()
+    if len(fields) == 3 and fields[1] in "tT":
+        symbols.setdefault(int(fields[0], 16), fields[2])
+
+# Function addresses in order of first entry.
+matcher = re.compile(r"Boot function 0x([0-9a-fA-F]+)")
+order   = []
+with open(args.log, errors="replace") as fd:
+    for line in fd:
+        match = matcher.search(line)
+        if match and int(match.group(1), 16) in symbols:
+            name = symbols[int(match.group(1), 16)]
+            if name not in order:
+                order.append(name)
+
+print("/* SPDX-License-Identifier: MIT */")
+print()
+print("/* Generated by tools/link-order.py: %d functions entered during boot. */" % len(order))
+for name in order:
+    print("*(.text.%s)" % name)
@@ -0,0 +1,403 @@
+// SPDX-License-Identifier: MIT
+
+// Host test for the LittleFS filesystem driver.
+// Build from the repository root with:
+//   cc -O2 -DHAS_FILESYS_LITTLEFS -Iinclude -Iinclude/badgelib -o littlefs-test
+//      tools/littlefs-test.c src/badgelib/badge_strings.c src/badgelib/checksum.c
+// Images are built in memory commit by commit, the way LittleFS v2 writes them: a superblock pair with an outdated
+// block, a /boot directory split over two metadata pairs by a hard tail, entries created, moved and deleted by later
+// commits, a commit with a bad CRC and /boot/kernel.bin as a CTZ skip-list in shuffled blocks or as inline data.
+// The kernel is read back through the driver, whole, mapped and in random ranges, counting media requests per block.
+
+#include "../src/arena.c"
+#include "../src/filesys/littlefs.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Number of blocks of the built images.
+#define BLOCK_COUNT 1024
+// Number of blocks before the filesystem, to check that partition offsets are applied.
+#define PART_BLOCKS 2
+// Size of the built images.
+#define IMAGE_SIZE  ((PART_BLOCKS + BLOCK_COUNT) * LFS_BLOCK_SIZE)
+// Largest kernel file.
+#define KERNEL_MAX  (LFS_MAX_FILE_BLOCKS + 8) * LFS_BLOCK_SIZE
+// Size of the boot arena.
+#define ARENA_SIZE  (64 * 1024)
+
+// Boot arena the driver allocates from; only referenced through the linker symbols.
+static uint8_t arena_mem[ARENA_SIZE] __attribute__((used, aligned(16)));
+#define STRINGIFY(x)  #x
+#define XSTRINGIFY(x) STRINGIFY(x)
+asm(".global __start_free_sram\n.set __start_free_sram, arena_mem\n"
+    ".global __stop_free_sram\n.set __stop_free_sram, arena_mem + " XSTRINGIFY(ARENA_SIZE));
+
+// Media contents.
+static uint8_t  image[IMAGE_SIZE];
+// Kernel file contents.
+static uint8_t  kernel[KERNEL_MAX];
+static size_t   kernel_len;
+// Number of media requests.
+static int      requests;
+// Number of failed checks.
+static int      failures;
+// Driver under test; registered by its constructor.
+static filesys_type_t *lfs_type;
+
+void logk(log_level_t level, char const *msg) {
+    (void)level;
+    (void)msg;
+}
+
+void logkf(log_level_t level, char const *msg, ...) {
+    (void)level;
+    (void)msg;
+}
+
+void filesys_type_register(filesys_type_t *type) {
+    lfs_type = type;
+}
+
+static diskoff_t media_read(bootmedia_t *media, diskoff_t offset, diskoff_t length, void *mem) {
+    (void)media;
+    requests++;
+    if (offset < 0 || length < 0 || offset > IMAGE_SIZE) {
+        return -1;
+    }
+    if (offset + length > IMAGE_SIZE) {
+        length = IMAGE_SIZE - offset;
+    }
+    memcpy(mem, image + offset, length);
+    return length;
+}
+
+static bool media_mmap(bootmedia_t *media, diskoff_t offset, diskoff_t length, size_t vaddr) {
+    // Mapping is modelled as a copy to the virtual address.
+    return media_read(media, offset, length, (void *)vaddr) == length;
+}
+
+static bootmedia_t media = {
+    .read = media_read,
+    .mmap = media_mmap,
+};
+
+static partition_t part = {
+    .media  = &media,
+    .offset = PART_BLOCKS * LFS_BLOCK_SIZE,
+    .length = BLOCK_COUNT * LFS_BLOCK_SIZE,
+};
+
+static void expect(char const *name, char const *what, bool ok) {
+    if (!ok && failures++ < 20) {
+        printf("FAIL %s: %s\n", name, what);
+    }
+}
+
+// Open the kernel on the current image and check it against the kernel contents.
+static void check_image(char const *name, size_t want_blocks) {
+    ARENA_SCOPE(image);
+    filesys_t filesys;
+    file_t    file = {0};
+    expect(name, "ident", lfs_type->ident(&part));
+    if (!lfs_type->read(&part, &filesys, &file)) {
+        expect(name, "open", false);
+        return;
+    }
+    expect(name, "size", file.size == (diskoff_t)kernel_len);
+    expect(name, "blocks", blocks_num == want_blocks);
+
+    // A whole read takes one media request per block, or one for inline data.
+    static uint8_t buf[KERNEL_MAX];
+    memset(buf, 0, kernel_len);
+    requests = 0;
+    expect(name, "read", file.read(&file, 0, kernel_len, buf) == (diskoff_t)kernel_len);
+    expect(name, "read data", !memcmp(buf, kernel, kernel_len));
+    expect(name, "read requests", requests == (int)(want_blocks ? want_blocks : kernel_len > 0));
+
+    memset(buf, 0, kernel_len);
+    expect(name, "mmap", file.mmap(&file, 0, kernel_len, (size_t)buf));
+    expect(name, "mmap data", !memcmp(buf, kernel, kernel_len));
+
+    // Reads past the end are truncated, reads starting past it fail.
+    if (kernel_len >= 10) {
+        expect(name, "truncated read", file.read(&file, kernel_len - 10, 100, buf) == 10);
+    }
+    expect(name, "out of range read", file.read(&file, kernel_len + 1, 1, buf) == -1);
+
+    for (int i = 0; i < 2000 && kernel_len; i++) {
+        diskoff_t offset = rand() % kernel_len;
+        diskoff_t length = rand() % 4 ? rand() % (2 * LFS_BLOCK_SIZE) : rand() % (diskoff_t)(kernel_len - offset + 1);
+        diskoff_t avail  = length < (diskoff_t)kernel_len - offset ? length : (diskoff_t)kernel_len - offset;
+        memset(buf, 0, avail);
+        expect(name, "random read", file.read(&file, offset, length, buf) == avail);
+        expect(name, "random data", !memcmp(buf, kernel + offset, avail));
+    }
+}
+
+// Check that the kernel cannot be opened on the current image.
+static void check_rejected(char const *name) {
+    ARENA_SCOPE(image);
+    filesys_t filesys;
+    file_t    file;
+    expect(name, "rejected", !lfs_type->read(&part, &filesys, &file));
+}
+
+
+
+// Metadata block being written.
+static struct {
+    uint8_t *data;
+    uint32_t off;
+    uint32_t ptag;
+    uint32_t crc;
+} img;
+
+// CRC-32 as LittleFS computes it, without the final inversion.
+static uint32_t img_crc(uint32_t crc, void const *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= ((uint8_t const *)data)[i];
+        for (int j = 0; j < 8; j++) crc = crc >> 1 ^ (crc & 1 ? 0xedb88320 : 0);
+    }
+    return crc;
+}
+
+// Get a pointer to a block of the filesystem.
+static uint8_t *img_block(uint32_t block) {
+    return image + (PART_BLOCKS + block) * LFS_BLOCK_SIZE;
+}
+
+// Erase a metadata block and start writing it with revision count `rev`.
+static void img_begin(uint32_t block, uint32_t rev) {
+    img.data = img_block(block);
+    memset(img.data, 0xff, LFS_BLOCK_SIZE);
+    for (int i = 0; i < 4; i++) img.data[i] = rev >> (8 * i);
+    img.off  = 4;
+    img.ptag = 0xffffffff;
+    img.crc  = img_crc(0xffffffff, img.data, 4);
+}
+
+// Append an encoded tag.
+static void img_put_tag(uint32_t tag) {
+    uint32_t raw = tag ^ img.ptag;
+    for (int i = 0; i < 4; i++) img.data[img.off + i] = raw >> (24 - 8 * i);
+    img.crc   = img_crc(img.crc, img.data + img.off, 4);
+    img.ptag  = tag;
+    img.off  += 4;
+}
+
+// Append a tag; a `size` of 0x3ff marks a deleted tag without data.
+static void img_tag(uint32_t type, uint32_t id, void const *data, uint32_t size) {
+    img_put_tag(type << 20 | id << 10 | size);
+    if (size != 0x3ff) {
+        memcpy(img.data + img.off, data, size);
+        img.crc  = img_crc(img.crc, data, size);
+        img.off += size;
+    }
+}
+
+// Append a tag with a metadata pair or CTZ head and size.
+static void img_tag_pair(uint32_t type, uint32_t id, uint32_t a, uint32_t b) {
+    uint8_t data[8];
+    for (int i = 0; i < 4; i++) {
+        data[i]     = a >> (8 * i);
+        data[4 + i] = b >> (8 * i);
+    }
+    img_tag(type, id, data, sizeof(data));
+}
+
+// Finish a commit; a corrupt commit is ignored along with everything after it.
+static void img_commit(bool corrupt) {
+    // The CRC tag's data is the CRC itself, which is not part of the CRC.
+    img_put_tag(0x500 << 20 | 0x3ff << 10 | 4);
+    uint32_t crc = img.crc ^ corrupt;
+    for (int i = 0; i < 4; i++) img.data[img.off + i] = crc >> (8 * i);
+    img.off += 4;
+    img.crc  = 0xffffffff;
+}
+
+// Write the kernel as a CTZ skip-list into shuffled free blocks; returns the head block.
+static uint32_t img_ctz() {
+    static uint32_t free_blocks[BLOCK_COUNT];
+    static uint32_t list[BLOCK_COUNT];
+    size_t          free_num = 0;
+    for (uint32_t i = 8; i < BLOCK_COUNT; i++) {
+        free_blocks[free_num++] = i;
+    }
+    for (size_t i = free_num - 1; i > 0; i--) {
+        size_t   j      = rand() % (i + 1);
+        uint32_t tmp    = free_blocks[i];
+        free_blocks[i]  = free_blocks[j];
+        free_blocks[j]  = tmp;
+    }
+
+    // Block `i` starts with pointers to blocks `i - 2^j` for every `2^j` dividing `i`.
+    size_t pos = 0;
+    for (uint32_t i = 0; pos < kernel_len; i++) {
+        list[i]      = free_blocks[--free_num];
+        uint8_t *blk = img_block(list[i]);
+        size_t   hdr = 0;
+        for (uint32_t j = 0; i && !(i & ((1u << j) - 1)); j++) {
+            uint32_t ptr = list[i - (1u << j)];
+            for (int k = 0; k < 4; k++) blk[hdr + k] = ptr >> (8 * k);
+            hdr += 4;
+        }
+        size_t chunk = kernel_len - pos < LFS_BLOCK_SIZE - hdr ? kernel_len - pos : LFS_BLOCK_SIZE - hdr;
+        memcpy(blk + hdr, kernel + pos, chunk);
+        pos += chunk;
+        if (pos == kernel_len) {
+            return list[i];
+        }
+    }
+    return 0;
+}
+
+// Build an image holding a `len` byte /boot/kernel.bin, stored inline or as a CTZ skip-list.
+static void build_image(size_t len, bool is_inline) {
+    memset(image, 0xff, sizeof(image));
+    kernel_len = len;
+    for (size_t i = 0; i < kernel_len; i++) {
+        kernel[i] = rand();
+    }
+    uint32_t head = is_inline ? 0 : img_ctz();
+
+    uint8_t sb[24];
+    uint32_t const sb_words[] = {0x20000, LFS_BLOCK_SIZE, BLOCK_COUNT, 255, 0x7fffffff, 1022};
+    for (int i = 0; i < 24; i++) sb[i] = sb_words[i / 4] >> (8 * (i % 4));
+
+    // Superblock pair 0,1; block 1 is an older revision without /boot.
+    img_begin(1, 7);
+    img_tag(LFS_TYPE_CREATE, 0, NULL, 0);
+    img_tag(LFS_TYPE_SUPERBLOCK, 0, "littlefs", 8);
+    img_tag(LFS_TYPE_INLINESTRUCT, 0, sb, sizeof(sb));
+    img_commit(false);
+    img_begin(0, 8);
+    img_tag(LFS_TYPE_SUPERBLOCK, 0, "littlefs", 8);
+    img_tag(LFS_TYPE_INLINESTRUCT, 0, sb, sizeof(sb));
+    img_tag(LFS_TYPE_DIR, 1, "boot", 4);
+    img_tag_pair(LFS_TYPE_DIRSTRUCT, 1, 2, 3);
+    img_tag_pair(0x600, 0x3ff, 2, 3);
+    img_commit(false);
+    // A later commit inserts a file before /boot, moving it to ID 2.
+    img_tag(LFS_TYPE_CREATE, 1, NULL, 0);
+    img_tag(LFS_TYPE_REG, 1, "aaa", 3);
+    img_tag(LFS_TYPE_INLINESTRUCT, 1, "hello", 5);
+    img_commit(false);
+    // A torn commit deleting /boot must be ignored.
+    img_tag(LFS_TYPE_DELETE, 2, NULL, 0x3ff);
+    img_commit(true);
+
+    // /boot, pair 2,3; block 3 is newer and holds a stale kernel entry that a later commit deletes.
+    img_begin(2, 1);
+    img_commit(false);
+    img_begin(3, 2);
+    img_tag(LFS_TYPE_CREATE, 0, NULL, 0);
+    img_tag(LFS_TYPE_REG, 0, "x", 1);
+    img_tag(LFS_TYPE_INLINESTRUCT, 0, "zz", 2);
+    img_tag(LFS_TYPE_CREATE, 1, NULL, 0);
+    img_tag(LFS_TYPE_REG, 1, "kernel.bin", 10);
+    img_tag_pair(LFS_TYPE_CTZSTRUCT, 1, 999, 1);
+    img_commit(false);
+    img_tag(LFS_TYPE_DELETE, 1, NULL, 0x3ff);
+    // Hard tail; /boot continues in pair 5,4.
+    img_tag_pair(0x601, 0x3ff, 5, 4);
+    img_commit(false);
+
+    // Continuation of /boot, pair 5,4; block 5 is an older revision with a stale kernel.
+    img_begin(5, 2);
+    img_tag(LFS_TYPE_CREATE, 0, NULL, 0);
+    img_tag(LFS_TYPE_REG, 0, "kernel.bin", 10);
+    img_tag_pair(LFS_TYPE_CTZSTRUCT, 0, 999, 1);
+    img_commit(false);
+    img_begin(4, 3);
+    img_tag(LFS_TYPE_CREATE, 0, NULL, 0);
+    img_tag(LFS_TYPE_REG, 0, "y", 1);
+    img_tag(LFS_TYPE_INLINESTRUCT, 0, "q", 1);
+    img_commit(false);
+    img_tag(LFS_TYPE_CREATE, 0, NULL, 0);
+    img_tag(LFS_TYPE_REG, 0, "kernel.bin", 10);
+    if (is_inline) {
+        img_tag(LFS_TYPE_INLINESTRUCT, 0, kernel, kernel_len);
+    } else {
+        img_tag_pair(LFS_TYPE_CTZSTRUCT, 0, head, kernel_len);
+    }
+    img_commit(false);
+    // A torn commit deleting the kernel must be ignored.
+    img_tag(LFS_TYPE_DELETE, 0, NULL, 0x3ff);
+    img_commit(true);
+}
+
+// Number of data bytes in CTZ block `index`, after its pointers.
+static size_t ctz_room(size_t index) {
+    size_t hdr = 0;
+    for (uint32_t j = 0; index && !(index & ((1u << j) - 1)); j++) hdr += 4;
+    return LFS_BLOCK_SIZE - hdr;
+}
+
+// Number of CTZ blocks of a file of `len` bytes.
+static size_t ctz_blocks(size_t len) {
+    size_t blocks = 0;
+    for (size_t pos = 0; pos < len; blocks++) pos += ctz_room(blocks);
+    return blocks;
+}
+
+// Largest file that fits in `blocks` CTZ blocks.
+static size_t ctz_capacity(size_t blocks) {
+    size_t len = 0;
+    for (size_t i = 0; i < blocks; i++) len += ctz_room(i);
+    return len;
+}
+
+int main() {
+    // CTZ kernels of every interesting size: one block, block boundaries and many blocks.
+    size_t const sizes[] = {
+        1,
+        LFS_BLOCK_SIZE - 1,
+        LFS_BLOCK_SIZE,
+        LFS_BLOCK_SIZE + 1,
+        2 * LFS_BLOCK_SIZE - 4,
+        2 * LFS_BLOCK_SIZE - 3,
+        700001,
+        ctz_capacity(LFS_MAX_FILE_BLOCKS),
+    };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(*sizes); i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "CTZ kernel of %zu bytes", sizes[i]);
+        build_image(sizes[i], false);
+        check_image(name, ctz_blocks(sizes[i]));
+    }
+
+    // Inline kernels.
+    build_image(0, true);
+    check_image("empty inline kernel", 0);
+    build_image(1000, true);
+    check_image("inline kernel", 0);
+
+    // A kernel larger than the block list, a missing kernel and a corrupted directory pair are rejected.
+    build_image(ctz_capacity(LFS_MAX_FILE_BLOCKS) + 1, false);
+    check_rejected("too many blocks");
+    build_image(5000, false);
+    img_begin(4, 3);
+    img_commit(false);
+    check_rejected("no kernel");
+    build_image(5000, false);
+    img_block(4)[20] ^= 1;
+    img_block(5)[20] ^= 1;
+    check_rejected("corrupted pair");
+
+    // The cache and block list need exactly their size in arena; less is an error.
+    build_image(5000, false);
+    for (size_t less = 0; less < 2; less++) {
+        ARENA_SCOPE(full);
+        arena_alloc(ARENA_SIZE - LFS_CACHE_BLOCKS * LFS_BLOCK_SIZE - ctz_blocks(5000) * 4 + less * 4, 1);
+        filesys_t filesys;
+        file_t    file;
+        bool opened = lfs_type->read(&part, &filesys, &file);
+        expect(less ? "arena full" : "arena just large enough", "open", opened == !less);
+    }
+    expect("arena", "freed", arena_used() == 0);
+
+    printf("correct:  %s\n", failures ? "NO" : "yes");
+    return failures != 0;
+}
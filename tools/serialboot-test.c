@@ -0,0 +1,308 @@
+// SPDX-License-Identifier: MIT
+
+// Host loopback test for serial download boot.
+// Build from the repository root with:
+//   cc -O2 -DHAS_BOOTMEDIA_SERIAL -DHAS_BOOTMEDIA_RAM -Iinclude -Iinclude/badgelib -Iport/esp32c6/include
+//      -o serialboot-test tools/serialboot-test.c src/badgelib/checksum.c
+// The frame decoder is fed garbage, corrupted and oversized frames. Then `serialboot_receive` runs against a
+// simulated host that speaks the go-back-N protocol of tools/serialboot.py over a link that drops and corrupts bytes,
+// and against a host that disappears halfway through a transfer.
+
+#include "../src/media/serial.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STRINGIFY(x)  #x
+#define XSTRINGIFY(x) STRINGIFY(x)
+
+// Receive window; serial.c places it right below `__start_data`.
+char test_window[SERIALBOOT_WINDOW_SIZE];
+asm(".global __start_data\n.set __start_data, test_window + " XSTRINGIFY(SERIALBOOT_WINDOW_SIZE));
+
+// Number of unacknowledged blocks the host keeps in flight.
+#define HOST_WINDOW     8
+// Fake microseconds after which the host resends from the last acknowledged block.
+#define HOST_RESEND_US  5000
+// Size of the host to device byte queue.
+#define HOST_QUEUE_SIZE (HOST_WINDOW * (SERIALBOOT_HDR_SIZE + SERIALBOOT_BLOCK_MAX + 4) * 2)
+
+ramboot_t ramboot;
+
+// Host transfer state.
+typedef enum {
+    HOST_START,
+    HOST_DATA,
+    HOST_END,
+    HOST_DONE,
+} host_state_t;
+
+// Image being sent.
+static uint8_t         image[SERIALBOOT_WINDOW_SIZE];
+static uint32_t        image_len;
+// Host to device bytes not yet read by the device.
+static uint8_t         queue[HOST_QUEUE_SIZE];
+static size_t          queue_head, queue_tail;
+// Host side frame decoder for device replies.
+static serialboot_rx_t host_rx;
+static host_state_t    host_state;
+// Blocks acknowledged and sent.
+static uint32_t        acked, sent;
+// Fake time of the last acknowledgement.
+static int64_t         last_ack;
+// Stop sending after this many blocks, to simulate a host that goes away.
+static uint32_t        host_stop;
+// Out of 1000 bytes, how many are dropped and how many corrupted.
+static int             drop_rate, corrupt_rate;
+// Fake microsecond clock.
+static int64_t         now;
+// Number of failed checks.
+static int             failures;
+
+void mem_copy(void *dest, void const *src, size_t size) {
+    memmove(dest, src, size);
+}
+
+void mem_set(void *dest, uint8_t value, size_t size) {
+    memset(dest, value, size);
+}
+
+timestamp_us_t time_us() {
+    return now++;
+}
+
+void logk(log_level_t level, char const *msg) {
+    (void)level;
+    printf("  %s\n", msg);
+}
+
+void logkf(log_level_t level, char const *msg, ...) {
+    (void)level;
+    (void)msg;
+}
+
+bool port_serialboot_requested() {
+    return true;
+}
+
+void rawflush() {
+}
+
+static void expect(char const *what, bool ok) {
+    if (!ok && failures++ < 10) {
+        printf("FAIL %s\n", what);
+    }
+}
+
+// Encode a frame like tools/serialboot.py does.
+static size_t encode(uint8_t *buf, serialboot_type_t type, uint32_t index, void const *payload, uint16_t length) {
+    buf[0] = SERIALBOOT_SYNC0;
+    buf[1] = SERIALBOOT_SYNC1;
+    buf[2] = type;
+    buf[3] = 0;
+    for (size_t i = 0; i < 4; i++) {
+        buf[4 + i] = index >> (8 * i);
+    }
+    buf[8] = length;
+    buf[9] = length >> 8;
+    memcpy(buf + SERIALBOOT_HDR_SIZE, payload, length);
+    crc32_t crc = crc32_init();
+    crc32_update(&crc, buf + 2, SERIALBOOT_HDR_SIZE - 2 + length);
+    crc32_final(&crc);
+    for (size_t i = 0; i < 4; i++) {
+        buf[SERIALBOOT_HDR_SIZE + length + i] = crc >> (8 * i);
+    }
+    return SERIALBOOT_HDR_SIZE + length + 4;
+}
+
+// Queue a frame for the device.
+static void host_send(serialboot_type_t type, uint32_t index, void const *payload, uint16_t length) {
+    static uint8_t buf[SERIALBOOT_HDR_SIZE + SERIALBOOT_BLOCK_MAX + 4];
+    size_t         len = encode(buf, type, index, payload, length);
+    for (size_t i = 0; i < len; i++) {
+        queue[queue_tail++ % HOST_QUEUE_SIZE] = buf[i];
+    }
+}
+
+// Queue the next frames according to the go-back-N protocol.
+static void host_pump() {
+    uint32_t blocks = (image_len + SERIALBOOT_BLOCK_MAX - 1) / SERIALBOOT_BLOCK_MAX;
+    bool     resend = now - last_ack > HOST_RESEND_US;
+    if (resend) {
+        last_ack = now;
+    }
+    switch (host_state) {
+        case HOST_START:
+            if (resend) {
+                uint8_t len[4] = {image_len, image_len >> 8, image_len >> 16, image_len >> 24};
+                host_send(SERIALBOOT_START, 0, len, 4);
+            }
+            break;
+        case HOST_DATA:
+            if (resend) {
+                sent = acked;
+            }
+            while (sent < blocks && sent < acked + HOST_WINDOW && sent < host_stop) {
+                uint32_t off = sent * SERIALBOOT_BLOCK_MAX;
+                uint32_t len = image_len - off < SERIALBOOT_BLOCK_MAX ? image_len - off : SERIALBOOT_BLOCK_MAX;
+                host_send(SERIALBOOT_DATA, sent, image + off, len);
+                sent++;
+            }
+            break;
+        case HOST_END:
+            if (resend) {
+                host_send(SERIALBOOT_END, 0, NULL, 0);
+            }
+            break;
+        case HOST_DONE: break;
+    }
+}
+
+// Device reply byte.
+void rawputc(char c) {
+    if (!serialboot_rx_byte(&host_rx, c)) {
+        return;
+    }
+    if (host_rx.type == SERIALBOOT_ERROR) {
+        // Like tools/serialboot.py, give up on an error.
+        host_state = HOST_DONE;
+        return;
+    }
+    if (host_rx.type != SERIALBOOT_ACK) {
+        return;
+    }
+    uint32_t blocks = (image_len + SERIALBOOT_BLOCK_MAX - 1) / SERIALBOOT_BLOCK_MAX;
+    last_ack        = now;
+    if (host_state == HOST_START && host_rx.index == 0) {
+        host_state = HOST_DATA;
+    } else if (host_state == HOST_DATA && host_rx.index > acked) {
+        acked = host_rx.index;
+        if (acked == blocks) {
+            host_state = HOST_END;
+            host_send(SERIALBOOT_END, 0, NULL, 0);
+        }
+    } else if (host_state == HOST_END && host_rx.index == blocks) {
+        host_state = HOST_DONE;
+    }
+}
+
+// Next host byte, dropped or corrupted at the configured rates; -1 if the link is idle.
+int rawgetc() {
+    while (1) {
+        if (queue_head == queue_tail) {
+            host_pump();
+            if (queue_head == queue_tail) {
+                return -1;
+            }
+        }
+        uint8_t c    = queue[queue_head++ % HOST_QUEUE_SIZE];
+        int     roll = rand() % 1000;
+        if (roll < drop_rate) {
+            continue;
+        }
+        if (roll < drop_rate + corrupt_rate) {
+            c ^= 1 << (rand() % 8);
+        }
+        return c;
+    }
+}
+
+// Run a serial boot transfer of `len` bytes.
+static void transfer(uint32_t len, int drop, int corrupt, uint32_t stop) {
+    for (uint32_t i = 0; i < len; i++) {
+        image[i] = rand();
+    }
+    image_len    = len;
+    drop_rate    = drop;
+    corrupt_rate = corrupt;
+    host_stop    = stop;
+    host_state   = HOST_START;
+    acked        = 0;
+    sent         = 0;
+    queue_head   = 0;
+    queue_tail   = 0;
+    now          = 0;
+    last_ack     = -HOST_RESEND_US - 1;
+    ramboot      = (ramboot_t){0};
+    memset(test_window, 0, sizeof(test_window));
+    serialboot_rx_init(&host_rx);
+    serialboot_receive();
+}
+
+// Feed bytes to a decoder and count the complete frames.
+static int feed(serialboot_rx_t *rx, uint8_t const *buf, size_t len) {
+    int frames = 0;
+    for (size_t i = 0; i < len; i++) {
+        frames += serialboot_rx_byte(rx, buf[i]);
+    }
+    return frames;
+}
+
+int main() {
+    static serialboot_rx_t rx;
+    static uint8_t         buf[4 * (SERIALBOOT_HDR_SIZE + SERIALBOOT_BLOCK_MAX + 4)];
+    uint8_t                payload[SERIALBOOT_BLOCK_MAX];
+    for (size_t i = 0; i < sizeof(payload); i++) {
+        payload[i] = i * 7;
+    }
+
+    // Frames are found after garbage and repeated synchronization bytes.
+    serialboot_rx_init(&rx);
+    size_t len   = 0;
+    buf[len++]   = 'x';
+    buf[len++]   = SERIALBOOT_SYNC0;
+    buf[len++]   = SERIALBOOT_SYNC0;
+    len         += encode(buf + len, SERIALBOOT_DATA, 0x12345678, payload, 300);
+    expect("frame after garbage", feed(&rx, buf, len) == 1);
+    expect("frame fields", rx.type == SERIALBOOT_DATA && rx.index == 0x12345678 && rx.length == 300);
+    expect("frame payload", !memcmp(rx.payload, payload, 300));
+
+    // Every single bit error is rejected, and the decoder recovers for the next frame.
+    // A corrupted length can swallow the bytes after the frame, so at most a full frame of padding precedes the next.
+    for (size_t bit = 0; bit < (SERIALBOOT_HDR_SIZE + 16 + 4) * 8; bit++) {
+        serialboot_rx_init(&rx);
+        len           = encode(buf, SERIALBOOT_DATA, 1, payload, 16);
+        buf[bit / 8] ^= 1 << (bit % 8);
+        memset(buf + len, 0, SERIALBOOT_BLOCK_MAX + 4);
+        len += SERIALBOOT_BLOCK_MAX + 4;
+        len += encode(buf + len, SERIALBOOT_END, 2, NULL, 0);
+        expect("bit error rejected", feed(&rx, buf, len) == 1 && rx.type == SERIALBOOT_END && rx.index == 2);
+    }
+
+    // Oversized frames are dropped without reading the payload.
+    serialboot_rx_init(&rx);
+    len    = encode(buf, SERIALBOOT_DATA, 0, payload, 16);
+    buf[8] = (SERIALBOOT_BLOCK_MAX + 1) & 0xff;
+    buf[9] = (SERIALBOOT_BLOCK_MAX + 1) >> 8;
+    feed(&rx, buf, len);
+    expect("oversized frame dropped", rx.dropped == 1 && rx.state == SERIALBOOT_RX_SYNC0);
+
+    // The device's replies decode with the same decoder.
+    serialboot_rx_init(&rx);
+    len = serialboot_encode(buf, SERIALBOOT_ACK, 42);
+    expect("reply frame", feed(&rx, buf, len) == 1 && rx.type == SERIALBOOT_ACK && rx.index == 42 && !rx.length);
+
+    // Loopback transfers over a clean and a lossy link.
+    uint32_t const lengths[] = {1, SERIALBOOT_BLOCK_MAX, SERIALBOOT_BLOCK_MAX + 1, 100000, SERIALBOOT_WINDOW_SIZE};
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        for (int lossy = 0; lossy < 2; lossy++) {
+            transfer(lengths[i], lossy ? 1 : 0, lossy ? 1 : 0, UINT32_MAX);
+            expect("image received", ramboot.magic == RAMBOOT_MAGIC && ramboot.length == lengths[i]);
+            // The 32-bit address field only holds the low half of a host pointer.
+            expect("image placement", ramboot.addr == (uint32_t)(size_t)test_window);
+            expect("image data", !memcmp(test_window, image, lengths[i]));
+        }
+    }
+
+    // Images larger than the window are refused; the host gives up and normal boot continues.
+    transfer(SERIALBOOT_WINDOW_SIZE + 1, 0, 0, UINT32_MAX);
+    expect("oversized image refused", ramboot.magic != RAMBOOT_MAGIC);
+
+    // A host that disappears mid-transfer does not hang the boot.
+    transfer(100000, 0, 0, 20);
+    expect("abandoned transfer", ramboot.magic != RAMBOOT_MAGIC && acked == 20);
+
+    printf("correct:  %s\n", failures ? "NO" : "yes");
+    return failures != 0;
+}
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+
+# Sends an image to KiloBootloader's serial download boot mode.
+# The device must be reset with the serial boot GPIO (GPIO2 unless built with another SERIALBOOT_GPIO) held low.
+# The BOOT button cannot be used: it is a strapping pin, and holding it at reset enters ROM download mode.
+
+import argparse, struct, time, zlib
+import serial
+
+SYNC       = b"\xa5\x5a"
+BLOCK_MAX  = 1024
+
+T_START    = 1
+T_DATA     = 2
+T_END      = 3
+T_ABORT    = 4
+T_ACK      = 5
+T_ERROR    = 6
+
+ERRORS = {1: "image too large for receive window", 2: "no transfer started"}
+
+
+def encode(ftype, index, payload=b""):
+    body = struct.pack("<BBIH", ftype, 0, index, len(payload)) + payload
+    return SYNC + body + struct.pack("<I", zlib.crc32(body))
+
+
+class Receiver:
+    def __init__(self, port):
+        self.port = port
+        self.buf  = b""
+
+    # Read the next valid frame, ignoring log output; returns None on timeout.
+    def frame(self, timeout):
+        deadline = time.monotonic() + timeout
+        while True:
+            idx = self.buf.find(SYNC)
+            if idx < 0:
+                self.buf = self.buf[-1:]
+            else:
+                self.buf = self.buf[idx:]
+                if len(self.buf) >= 14:
+                    ftype, _, index, length = struct.unpack("<BBIH", self.buf[2:10])
+                    if len(self.buf) >= 14 + length:
+                        body = self.buf[2:10 + length]
+                        crc, = struct.unpack("<I", self.buf[10 + length:14 + length])
+                        if crc == zlib.crc32(body):
+                            self.buf = self.buf[14 + length:]
+                            return ftype, index
+                        self.buf = self.buf[2:]
+                        continue
+            if time.monotonic() > deadline:
+                return None
+            self.buf += self.port.read(self.port.in_waiting or 1)
+
+
+def send(port, image, window, timeout):
+    rx     = Receiver(port)
+    blocks = [image[i:i + BLOCK_MAX] for i in range(0, len(image), BLOCK_MAX)]
+
+    # Start the transfer.
+    while True:
+        port.write(encode(T_START, 0, struct.pack("<I", len(image))))
+        res = rx.frame(timeout)
+        if res and res[0] == T_ERROR:
+            raise RuntimeError("Device refused image: " + ERRORS.get(res[1], str(res[1])))
+        if res and res[0] == T_ACK and res[1] == 0:
+            break
+
+    # Go-back-N sliding window: keep up to `window` blocks in flight.
+    acked  = 0
+    sent   = 0
+    start  = time.monotonic()
+    while acked < len(blocks):
+        while sent < len(blocks) and sent < acked + window:
+            port.write(encode(T_DATA, sent, blocks[sent]))
+            sent += 1
+        res = rx.frame(timeout)
+        if res is None:
+            # Lost frame or acknowledgement; resend from the last acknowledged block.
+            sent = acked
+        elif res[0] == T_ERROR:
+            raise RuntimeError("Device error: " + ERRORS.get(res[1], str(res[1])))
+        elif res[0] == T_ACK:
+            if res[1] > acked:
+                acked = res[1]
+            elif sent > acked + 1:
+                # Device is still waiting for `acked`; rewind.
+                sent = acked
+        print("\r{}/{} blocks".format(acked, len(blocks)), end="", flush=True)
+    elapsed = time.monotonic() - start
+    print("\n{} bytes in {:.2f}s ({:.1f} KiB/s)".format(len(image), elapsed, len(image) / 1024 / max(elapsed, 1e-6)))
+
+    # End the transfer.
+    while True:
+        port.write(encode(T_END, 0))
+        res = rx.frame(timeout)
+        if res and res[0] == T_ACK and res[1] == len(blocks):
+            return
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Send an image to KiloBootloader over serial")
+    parser.add_argument("port", help="Serial port, e.g. /dev/ttyACM0")
+    parser.add_argument("image", help="ESP image to boot")
+    parser.add_argument("--baud", type=int, default=115200, help="UART baudrate (ignored by USB-Serial-JTAG)")
+    parser.add_argument("--window", type=int, default=8, help="Number of unacknowledged blocks in flight")
+    parser.add_argument("--timeout", type=float, default=0.5, help="Acknowledgement timeout in seconds")
+    parser.add_argument("--abort", action="store_true", help="Abort serial boot and continue normal boot")
+    args = parser.parse_args()
+
+    with serial.Serial(args.port, args.baud, timeout=0.05) as port:
+        if args.abort:
+            port.write(encode(T_ABORT, 0))
+        else:
+            send(port, open(args.image, "rb").read(), args.window, args.timeout)
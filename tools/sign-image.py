@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+
+# Ed25519 signing of ESP images for signed boot.
+# The signature covers the SHA-256 of the image up to and including the checksum byte, which is also the hash the
+# image may already have appended. A signature block (magic "KBSG" + 64-byte signature) is appended after the image.
+
+import os, argparse
+from pathlib import Path
+from hashlib import sha256, sha512
+
+SIG_MAGIC = b"KBSG"
+
+# Ed25519 as in RFC 8032 section 6; speed is irrelevant for signing a handful of images.
+p = 2**255 - 19
+q = 2**252 + 27742317777372353535851937790883648493
+d = -121665 * pow(121666, p - 2, p) % p
+
+def point_add(P, Q):
+    A = (P[1] - P[0]) * (Q[1] - Q[0]) % p
+    B = (P[1] + P[0]) * (Q[1] + Q[0]) % p
+    C = 2 * P[3] * Q[3] * d % p
+    D = 2 * P[2] * Q[2] % p
+    E, F, G, H = B - A, D - C, D + C, B + A
+    return (E * F, G * H, F * G, E * H)
+
+def point_mul(s, P):
+    Q = (0, 1, 1, 0)
+    while s > 0:
+        if s & 1:
+            Q = point_add(Q, P)
+        P = point_add(P, P)
+        s >>= 1
+    return Q
+
+def recover_x(y, sign):
+    x2 = (y * y - 1) * pow(d * y * y + 1, p - 2, p)
+    x = pow(x2, (p + 3) // 8, p)
+    if (x * x - x2) % p != 0:
+        x = x * pow(2, (p - 1) // 4, p) % p
+    if (x & 1) != sign:
+        x = p - x
+    return x
+
+g_y = 4 * pow(5, p - 2, p) % p
+g_x = recover_x(g_y, 0)
+G = (g_x, g_y, 1, g_x * g_y % p)
+
+def point_compress(P):
+    zinv = pow(P[2], p - 2, p)
+    x = P[0] * zinv % p
+    y = P[1] * zinv % p
+    return int.to_bytes(y | ((x & 1) << 255), 32, "little")
+
+def secret_expand(secret):
+    h = sha512(secret).digest()
+    a = int.from_bytes(h[:32], "little")
+    a &= (1 << 254) - 8
+    a |= 1 << 254
+    return (a, h[32:])
+
+def secret_to_public(secret):
+    a, _ = secret_expand(secret)
+    return point_compress(point_mul(a, G))
+
+def sign(secret, msg):
+    a, prefix = secret_expand(secret)
+    A = point_compress(point_mul(a, G))
+    r = int.from_bytes(sha512(prefix + msg).digest(), "little") % q
+    R = point_compress(point_mul(r, G))
+    h = int.from_bytes(sha512(R + A + msg).digest(), "little") % q
+    s = (r + h * a) % q
+    return R + int.to_bytes(s, 32, "little")
+
+
+
+def image_end(raw):
+    # Walk the segment table to find the checksum byte.
+    seg_num = raw[1]
+    off = 24
+    for _ in range(seg_num):
+        off += 8 + int.from_bytes(raw[off + 4:off + 8], "little")
+    off += 15 - off % 16
+    return off + 1
+
+def sign_image(secret, raw):
+    end = image_end(raw)
+    digest = sha256(raw[:end]).digest()
+    if raw[23]:
+        end += 32
+    return raw[:end] + SIG_MAGIC + sign(secret, digest)
+
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    genkey = sub.add_parser("genkey", help="generate a new private key")
+    genkey.add_argument("key", type=Path)
+    pubkey = sub.add_parser("pubkey", help="print the public key as hex for ESP_SIGNED_BOOT_KEY")
+    pubkey.add_argument("key", type=Path)
+    signp = sub.add_parser("sign", help="append a signature block to an ESP image")
+    signp.add_argument("key", type=Path)
+    signp.add_argument("input", type=Path)
+    signp.add_argument("output", type=Path)
+    args = parser.parse_args()
+
+    if args.cmd == "genkey":
+        args.key.write_bytes(os.urandom(32))
+    elif args.cmd == "pubkey":
+        print(secret_to_public(args.key.read_bytes()).hex())
+    else:
+        args.output.write_bytes(sign_image(args.key.read_bytes(), args.input.read_bytes()))
+
+if __name__ == "__main__":
+    main()
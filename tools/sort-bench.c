@@ -0,0 +1,231 @@
+// SPDX-License-Identifier: MIT
+
+// Host test and benchmark for the sorts in arrays.c and arrays.h.
+// Build from the repository root with:
+//   cc -O2 -Iinclude/badgelib -o sort-bench tools/sort-bench.c src/badgelib/arrays.c
+// Every sort is checked against a stable reference sort; the benchmark compares each with the C library's qsort
+// on partition-table-sized and FAT-sized inputs, both shuffled and nearly sorted.
+
+#include "arrays.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define READ_CYCLES() __rdtsc()
+#elif defined(__riscv)
+static inline uint64_t read_cycles() {
+    uint64_t cycles;
+    asm volatile("rdcycle %0" : "=r"(cycles));
+    return cycles;
+}
+#define READ_CYCLES() read_cycles()
+#else
+#define READ_CYCLES() 0
+#endif
+
+// Largest input size.
+#define MAX_COUNT 4096
+
+// Sorted entry, shaped like a vectored read request; `index` records the original order to check stability.
+typedef struct {
+    uint32_t key;
+    uint32_t index;
+    void    *mem;
+} entry_t;
+
+// The bootloader's mem_copy, backed by the C library on the host.
+void mem_copy(void *dest, void const *src, size_t size) {
+    memmove(dest, src, size);
+}
+
+static int entry_comp(void const *a, void const *b) {
+    uint32_t key_a = ((entry_t const *)a)->key;
+    uint32_t key_b = ((entry_t const *)b)->key;
+    return (key_a > key_b) - (key_a < key_b);
+}
+
+static int entry_comp_stable(void const *a, void const *b) {
+    int res = entry_comp(a, b);
+    return res ? res : (int)((entry_t const *)a)->index - (int)((entry_t const *)b)->index;
+}
+
+static inline bool entry_less(entry_t const *a, entry_t const *b) {
+    return a->key < b->key;
+}
+
+ARRAY_SORT_DEFINE(entry_sort, entry_t, entry_less)
+
+static int u32_comp(void const *a, void const *b) {
+    uint32_t val_a = *(uint32_t const *)a;
+    uint32_t val_b = *(uint32_t const *)b;
+    return (val_a > val_b) - (val_a < val_b);
+}
+
+static inline bool u32_less(uint32_t const *a, uint32_t const *b) {
+    return *a < *b;
+}
+
+ARRAY_SORT_DEFINE(u32_sort, uint32_t, u32_less)
+
+// Number of failed checks.
+static int      failures;
+// Input, reference and output arrays.
+static entry_t  input[MAX_COUNT], expect[MAX_COUNT], output[MAX_COUNT], tmp[MAX_COUNT / 2];
+static uint32_t input_u32[MAX_COUNT], output_u32[MAX_COUNT], tmp_u32[MAX_COUNT / 2];
+
+// Fill the input with `count` entries; `spread` limits the number of distinct keys and `swaps` makes it nearly sorted.
+static void fill(size_t count, uint32_t spread, size_t swaps) {
+    for (size_t i = 0; i < count; i++) {
+        input[i].key   = swaps ? i * spread / count : (uint32_t)rand() % spread;
+        input[i].index = i;
+        input[i].mem   = NULL;
+    }
+    for (size_t i = 0; i < swaps; i++) {
+        size_t   a   = rand() % count;
+        size_t   b   = rand() % count;
+        uint32_t key = input[a].key;
+        input[a].key = input[b].key;
+        input[b].key = key;
+    }
+    for (size_t i = 0; i < count; i++) {
+        input_u32[i] = input[i].key;
+    }
+}
+
+static void check(char const *name, size_t count) {
+    if (memcmp(output, expect, sizeof(entry_t) * count)) {
+        if (failures++ < 10) {
+            printf("FAIL %s with %zu entries\n", name, count);
+        }
+    }
+}
+
+static void check_u32(char const *name, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (output_u32[i] != expect[i].key) {
+            if (failures++ < 10) {
+                printf("FAIL %s with %zu entries\n", name, count);
+            }
+            return;
+        }
+    }
+}
+
+// Check every sort against the reference on the current input.
+static void check_all(size_t count) {
+    memcpy(expect, input, sizeof(entry_t) * count);
+    qsort(expect, count, sizeof(entry_t), entry_comp_stable);
+
+    memcpy(output, input, sizeof(entry_t) * count);
+    array_sort(output, sizeof(entry_t), count, entry_comp);
+    check("array_sort", count);
+    memcpy(output, input, sizeof(entry_t) * count);
+    array_sort_buf(output, tmp, sizeof(entry_t), count, entry_comp);
+    check("array_sort_buf", count);
+    memcpy(output, input, sizeof(entry_t) * count);
+    entry_sort(output, count);
+    check("entry_sort", count);
+    memcpy(output, input, sizeof(entry_t) * count);
+    entry_sort_buf(output, tmp, count);
+    check("entry_sort_buf", count);
+
+    memcpy(output_u32, input_u32, sizeof(uint32_t) * count);
+    u32_sort(output_u32, count);
+    check_u32("u32_sort", count);
+    memcpy(output_u32, input_u32, sizeof(uint32_t) * count);
+    u32_sort_buf(output_u32, tmp_u32, count);
+    check_u32("u32_sort_buf", count);
+}
+
+// Sort being benchmarked.
+enum {
+    SORT_QSORT,
+    SORT_ARRAY,
+    SORT_ARRAY_BUF,
+    SORT_TYPED,
+    SORT_TYPED_BUF,
+    SORT_COUNT,
+};
+
+// Least cycles of sorting the current input of `count` entries with `sort`.
+static uint64_t bench(int sort, bool u32, size_t count) {
+    uint64_t best = UINT64_MAX;
+    for (int run = 0; run < 50; run++) {
+        memcpy(output, input, sizeof(entry_t) * count);
+        memcpy(output_u32, input_u32, sizeof(uint32_t) * count);
+        uint64_t start = READ_CYCLES();
+        switch (sort) {
+            case SORT_QSORT:
+                u32 ? qsort(output_u32, count, sizeof(uint32_t), u32_comp)
+                    : qsort(output, count, sizeof(entry_t), entry_comp);
+                break;
+            case SORT_ARRAY:
+                u32 ? array_sort(output_u32, sizeof(uint32_t), count, u32_comp)
+                    : array_sort(output, sizeof(entry_t), count, entry_comp);
+                break;
+            case SORT_ARRAY_BUF:
+                u32 ? array_sort_buf(output_u32, tmp_u32, sizeof(uint32_t), count, u32_comp)
+                    : array_sort_buf(output, tmp, sizeof(entry_t), count, entry_comp);
+                break;
+            case SORT_TYPED: u32 ? u32_sort(output_u32, count) : entry_sort(output, count); break;
+            case SORT_TYPED_BUF:
+                u32 ? u32_sort_buf(output_u32, tmp_u32, count) : entry_sort_buf(output, tmp, count);
+                break;
+        }
+        uint64_t took = READ_CYCLES() - start;
+        if (took < best) {
+            best = took;
+        }
+    }
+    return best;
+}
+
+// Print the cycles of each sort on the current input.
+static void bench_row(char const *name, bool u32, size_t count) {
+    printf("%-22s", name);
+    for (int sort = 0; sort < SORT_COUNT; sort++) {
+        printf(" %10llu", (unsigned long long)bench(sort, u32, count));
+    }
+    printf("\n");
+}
+
+int main() {
+    // Every size up to a few merge levels, with few and many distinct keys, shuffled and nearly sorted.
+    for (size_t count = 0; count <= 4 * ARRAY_SORT_RUN + 3; count++) {
+        for (int run = 0; run < 100; run++) {
+            fill(count, 4, 0);
+            check_all(count);
+            fill(count, UINT32_MAX, 0);
+            check_all(count);
+            fill(count, count + 1, count ? 1 + rand() % 3 : 0);
+            check_all(count);
+        }
+    }
+    for (int run = 0; run < 20; run++) {
+        fill(MAX_COUNT, 64, 0);
+        check_all(MAX_COUNT);
+        fill(MAX_COUNT, UINT32_MAX, 0);
+        check_all(MAX_COUNT);
+    }
+    printf("correct:  %s\n", failures ? "NO" : "yes");
+
+    // Cycles per sort; the partition table and FAT extent list hold 16 and 32 entries, a FAT12 chain up to 4096.
+    printf("input                       qsort array_sort  array_buf      typed  typed_buf\n");
+    fill(16, UINT32_MAX, 0);
+    bench_row("16 partitions", false, 16);
+    fill(16, 16, 2);
+    bench_row("16 partitions, sorted", false, 16);
+    fill(32, UINT32_MAX, 0);
+    bench_row("32 extents", false, 32);
+    fill(32, 32, 2);
+    bench_row("32 extents, sorted", false, 32);
+    fill(MAX_COUNT, UINT32_MAX, 0);
+    bench_row("4096 clusters", true, MAX_COUNT);
+    fill(MAX_COUNT, MAX_COUNT, 16);
+    bench_row("4096 clusters, sorted", true, MAX_COUNT);
+    return failures != 0;
+}